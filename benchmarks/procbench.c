@@ -0,0 +1,67 @@
+/*
+ * Process table benchmark. Each round forks children until NUM_PROCS exist or
+ * fork1() fails, then joins them all, and reports the cost of each fork1()
+ * and join(). The children run below start1, so they all exist at once.
+ *
+ * Build the kernel with -DMAX_PROCESSES=100000 to exercise a large table.
+ */
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#ifndef NUM_PROCS
+#define NUM_PROCS 100000
+#endif
+
+#define ROUNDS 3
+
+int Child(char *);
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static int now(void)
+{
+    int time;
+    USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &time);
+    return time;
+}
+
+int start1(char *arg)
+{
+    int status;
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        int forked = 0;
+        int start = now();
+        while (forked < NUM_PROCS && fork1("Child", Child, NULL, USLOSS_MIN_STACK, 5) > 0)
+        {
+            forked++;
+        }
+        int forkTime = now() - start;
+
+        start = now();
+        for (int i = 0; i < forked; i++)
+        {
+            join(&status);
+        }
+        int joinTime = now() - start;
+
+        USLOSS_Console("round %d: %d processes, fork1() %.2f us, join() %.2f us\n",
+                       round, forked, (double) forkTime / forked, (double) joinTime / forked);
+    }
+    quit(0);
+    return 0;
+}
+
+int Child(char *arg)
+{
+    quit(0);
+    return 0;
+}
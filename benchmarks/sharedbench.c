@@ -0,0 +1,170 @@
+/*
+ * Shared stack benchmark. Compares processes from fork1() with lightweight
+ * ones from forkLight() on the two things the shared stack trades:
+ *
+ *  - switch cost: two processes yield() to each other SWITCHES times from a
+ *    given stack depth. Lightweight ones copy their frames off and onto the
+ *    shared stack on every switch.
+ *  - memory: NUM_PROCS processes are forked and left blocked, and the growth
+ *    of the address space and of resident memory is read from /proc (Linux).
+ *
+ * Build the kernel with -DMAX_PROCESSES=100000 to exercise many processes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#ifndef NUM_PROCS
+#define NUM_PROCS 10000
+#endif
+
+#define SWITCHES 100000
+#define FRAME_BYTES 256
+#define BLOCKED 11
+
+int PingPong(char *);
+int Blocker(char *);
+
+static int Pids[NUM_PROCS];
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static int now(void)
+{
+    int time;
+    USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &time);
+    return time;
+}
+
+/*
+ * Reads the size of the address space and the resident memory, in KB.
+ */
+static void memoryUse(long *virtualKB, long *residentKB)
+{
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm != NULL)
+    {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        {
+            pages = resident = 0;
+        }
+        fclose(statm);
+    }
+    long pageKB = sysconf(_SC_PAGESIZE) / 1024;
+    *virtualKB = pages * pageKB;
+    *residentKB = resident * pageKB;
+}
+
+static int forkKind(int lightweight, char *name, int (*func)(char *), char *arg, int priority)
+{
+    if (lightweight)
+    {
+        return forkLight(name, func, arg, priority);
+    }
+    return fork1(name, func, arg, USLOSS_MIN_STACK, priority);
+}
+
+static void switchCost(int lightweight, int depth)
+{
+    char arg[16];
+    int status;
+
+    sprintf(arg, "%d", depth);
+    int start = now();
+    forkKind(lightweight, "PingPong", PingPong, arg, 2);
+    forkKind(lightweight, "PingPong", PingPong, arg, 2);
+    join(&status);
+    join(&status);
+    int time = now() - start;
+
+    USLOSS_Console("%-11s depth %5d bytes: %.3f us per switch\n", lightweight ? "forkLight()" : "fork1()",
+                   depth * FRAME_BYTES, (double) time / (2 * SWITCHES));
+}
+
+static void memoryCost(int lightweight)
+{
+    long virtualBefore, residentBefore, virtualAfter, residentAfter;
+    int status;
+
+    memoryUse(&virtualBefore, &residentBefore);
+    int forked = 0;
+    while (forked < NUM_PROCS)
+    {
+        int pid = forkKind(lightweight, "Blocker", Blocker, NULL, 1);
+        if (pid < 0)
+        {
+            break;
+        }
+        Pids[forked++] = pid;
+    }
+    // Let them all run to blockMe()
+    yield();
+    memoryUse(&virtualAfter, &residentAfter);
+
+    unblockProcs(Pids, forked);
+    for (int i = 0; i < forked; i++)
+    {
+        join(&status);
+    }
+
+    USLOSS_Console("%-11s %d blocked processes: %.1f KB address space, %.1f KB resident each\n",
+                   lightweight ? "forkLight()" : "fork1()", forked,
+                   (double) (virtualAfter - virtualBefore) / forked,
+                   (double) (residentAfter - residentBefore) / forked);
+}
+
+int start1(char *arg)
+{
+    int depths[] = { 0, 16, 64 };
+
+    for (int i = 0; i < sizeof(depths) / sizeof(depths[0]); i++)
+    {
+        switchCost(0, depths[i]);
+        switchCost(1, depths[i]);
+    }
+    memoryCost(0);
+    memoryCost(1);
+    quit(0);
+    return 0;
+}
+
+/*
+ * Recurses depth frames deep, then yields SWITCHES times.
+ */
+static int descend(int depth)
+{
+    volatile char frame[FRAME_BYTES];
+    frame[0] = depth;
+    if (depth > 0)
+    {
+        return descend(depth - 1) + frame[0];
+    }
+    for (int i = 0; i < SWITCHES; i++)
+    {
+        yield();
+    }
+    return 0;
+}
+
+int PingPong(char *arg)
+{
+    descend(atoi(arg));
+    quit(0);
+    return 0;
+}
+
+int Blocker(char *arg)
+{
+    blockMe(BLOCKED);
+    quit(0);
+    return 0;
+}
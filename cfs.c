@@ -0,0 +1,178 @@
+/* ------------------------------------------------------------------------
+   cfs.c
+   Completely fair scheduler policy. Every process accumulates virtual
+   runtime: the CPU time it uses, scaled down by its weight (CFS_WEIGHT of
+   its priority). The runnable process with the least virtual runtime runs
+   next, and timeSlice() preempts the running process once it is no longer
+   the furthest behind, provided it has run for at least
+   CFS_MIN_GRANULARITY so that processes with similar virtual runtimes do not
+   thrash.
+
+   Processes at SENTINELPRIORITY have no weight; they stay on the ReadyList
+   and only run when nothing else is runnable.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+
+   ------------------------------------------------------------------------ */
+
+#include "sched.h"
+#include "queue.h"
+#include "heap.h"
+#include "phase1utility.h"
+
+extern priorityQueue ReadyList;
+extern int debugflag;
+
+static void cfsInit(void);
+static void cfsEnqueue(procPtr);
+static void cfsDequeue(procPtr);
+static procPtr cfsPickNext(void);
+static int cfsTick(procPtr, int);
+static void cfsCharge(procPtr, int);
+static int cfsContended(procPtr);
+static int cfsPreempts(procPtr, procPtr);
+static void cfsPicked(procPtr);
+static long scaleByWeight(procPtr, long);
+
+// Runnable weighted processes, ordered by virtual runtime
+static procHeap RunQueue;
+
+// Never decreases; the virtual runtime new and woken processes start from
+static long minVruntime = 0;
+
+schedOps CFSOps =
+{
+    "cfs",
+    cfsInit,
+    cfsEnqueue,
+    cfsDequeue,
+    cfsPickNext,
+    cfsTick,
+    cfsEnqueue,
+    cfsCharge,
+    cfsContended,
+    cfsPreempts,
+    cfsPicked,
+};
+
+static void cfsInit(void)
+{
+    initPriorityQueue(&ReadyList);
+    initHeap(&RunQueue);
+    minVruntime = 0;
+}
+
+/*
+ * Makes proc runnable. A process that is new or has been blocked starts at
+ * minVruntime, so it cannot claim the CPU for all the time it was away.
+ */
+static void cfsEnqueue(procPtr proc)
+{
+    if (proc->priority == SENTINELPRIORITY)
+    {
+        addProc(&ReadyList, proc);
+        return;
+    }
+    if (proc->vruntime < minVruntime)
+    {
+        proc->vruntime = minVruntime;
+    }
+    heapInsert(&RunQueue, proc, proc->vruntime);
+}
+
+static void cfsDequeue(procPtr proc)
+{
+    heapRemove(&RunQueue, proc);
+    unlinkProc(&ReadyList, proc);
+}
+
+static procPtr cfsPickNext(void)
+{
+    procPtr next = heapRemoveMin(&RunQueue);
+    if (next == NULL)
+    {
+        return removeProc(&ReadyList);
+    }
+    cfsPicked(next);
+    return next;
+}
+
+/*
+ * Moves minVruntime up to the virtual runtime of the process about to run.
+ */
+static void cfsPicked(procPtr proc)
+{
+    if (proc->priority != SENTINELPRIORITY && proc->vruntime > minVruntime)
+    {
+        minVruntime = proc->vruntime;
+    }
+}
+
+/*
+ * Preempts proc once it has run for the minimum granularity and its virtual
+ * runtime, counting the time it has been running, has passed that of the
+ * process furthest behind.
+ */
+static int cfsTick(procPtr proc, int currentTime)
+{
+    int ran = currentTime - proc->startTime;
+    procPtr leftmost = heapPeekMin(&RunQueue);
+    if (ran < CFS_MIN_GRANULARITY)
+    {
+        return 0;
+    }
+    if (proc->priority == SENTINELPRIORITY)
+    {
+        return leftmost != NULL;
+    }
+    return leftmost != NULL && proc->vruntime + scaleByWeight(proc, ran) > leftmost->vruntime;
+}
+
+/*
+ * Any waiting weighted process competes with the running process.
+ */
+static int cfsContended(procPtr proc)
+{
+    return RunQueue.size > 0;
+}
+
+/*
+ * A process whose virtual runtime is behind the running process's runs first.
+ * The sentinel gives way to anyone.
+ */
+static int cfsPreempts(procPtr proc, procPtr running)
+{
+    if (running->priority == SENTINELPRIORITY)
+    {
+        return 1;
+    }
+    return proc->priority != SENTINELPRIORITY && proc->vruntime < running->vruntime;
+}
+
+/*
+ * Adds the CPU time proc just used, scaled by its weight, to its virtual
+ * runtime.
+ */
+static void cfsCharge(procPtr proc, int deltaTime)
+{
+    if (proc->priority == SENTINELPRIORITY)
+    {
+        return;
+    }
+    proc->vruntime += scaleByWeight(proc, deltaTime);
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("cfsCharge(): Process %d now has vruntime %ld.\n", proc->pid, proc->vruntime);
+    }
+}
+
+/*
+ * Converts deltaTime microseconds of real CPU time into virtual runtime for
+ * proc. A process at MINPRIORITY accrues virtual runtime in real time.
+ */
+static long scaleByWeight(procPtr proc, long deltaTime)
+{
+    return deltaTime * CFS_WEIGHT(MINPRIORITY) / CFS_WEIGHT(proc->priority);
+}
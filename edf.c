@@ -0,0 +1,263 @@
+/* ------------------------------------------------------------------------
+   edf.c
+   Earliest deadline first real-time scheduling class. A process becomes
+   real-time by declaring a period, a budget and a relative deadline with
+   setDeadline(). It is released at the start of every period with a fresh
+   budget and an absolute deadline of release time + relative deadline.
+
+   Real-time processes sit in front of whatever policy SCHED_POLICY selects:
+   the runnable one with the earliest absolute deadline always runs ahead of
+   every normal process. The clock path enforces the budget: a process that
+   uses it all is throttled until its next release.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+
+   ------------------------------------------------------------------------ */
+
+#include "sched.h"
+#include "heap.h"
+#include "phase1utility.h"
+
+extern procPtr Current;
+extern int debugflag;
+
+static void edfInit(void);
+static void edfEnqueue(procPtr);
+static void edfDequeue(procPtr);
+static procPtr edfPickNext(void);
+static int edfTick(procPtr, int);
+static void edfCharge(procPtr, int);
+static int edfContended(procPtr);
+static int edfPreempts(procPtr, procPtr);
+static void release(procPtr, int);
+
+// Runnable real-time processes, ordered by absolute deadline
+static procHeap DeadlineQueue;
+
+// Linked list (through nextRTProcPtr) of every real-time process
+static procPtr RealTimeProcs = NULL;
+
+schedOps RealTimeOps =
+{
+    "edf",
+    edfInit,
+    edfEnqueue,
+    edfDequeue,
+    edfPickNext,
+    edfTick,
+    edfEnqueue,
+    edfCharge,
+    edfContended,
+    edfPreempts,
+    noPicked,
+};
+
+static void edfInit(void)
+{
+    initHeap(&DeadlineQueue);
+    RealTimeProcs = NULL;
+}
+
+static void edfEnqueue(procPtr proc)
+{
+    heapInsert(&DeadlineQueue, proc, proc->rtAbsDeadline);
+}
+
+static void edfDequeue(procPtr proc)
+{
+    heapRemove(&DeadlineQueue, proc);
+}
+
+/*
+ * Returns the runnable real-time process with the earliest deadline, or NULL
+ * if there is none.
+ */
+static procPtr edfPickNext(void)
+{
+    return heapRemoveMin(&DeadlineQueue);
+}
+
+/*
+ * Releases every real-time process whose period has started, then decides
+ * whether proc must give up the CPU: a real-time proc that has used its
+ * budget is throttled, and any proc is preempted by a runnable real-time proc
+ * with an earlier deadline.
+ */
+static int edfTick(procPtr proc, int currentTime)
+{
+    for (procPtr rt = RealTimeProcs; rt != NULL; rt = rt->nextRTProcPtr)
+    {
+        if (currentTime >= rt->rtNextRelease)
+        {
+            release(rt, currentTime);
+        }
+    }
+
+    if (IS_REAL_TIME(proc) && proc->status == STATUS_READY &&
+        proc->rtBudgetLeft - (currentTime - proc->startTime) <= 0)
+    {
+        if (DEBUG && debugflag)
+        {
+            USLOSS_Console("edfTick(): Process %d used its budget. Throttling.\n", proc->pid);
+        }
+        proc->status = STATUS_THROTTLED;
+        return 1;
+    }
+
+    procPtr earliest = heapPeekMin(&DeadlineQueue);
+    return earliest != NULL && (!IS_REAL_TIME(proc) || earliest->rtAbsDeadline < proc->rtAbsDeadline);
+}
+
+/*
+ * Takes the CPU time proc just used out of its budget.
+ */
+static void edfCharge(procPtr proc, int deltaTime)
+{
+    proc->rtBudgetLeft -= deltaTime;
+}
+
+/*
+ * Periods are released and budgets enforced from the clock, so it is needed
+ * whenever any real-time process exists.
+ */
+static int edfContended(procPtr proc)
+{
+    return RealTimeProcs != NULL;
+}
+
+/*
+ * Between real-time processes, the earlier deadline runs first.
+ */
+static int edfPreempts(procPtr proc, procPtr running)
+{
+    return proc->rtAbsDeadline < running->rtAbsDeadline;
+}
+
+/*
+ * Makes proc a real-time process with the given period, budget and relative
+ * deadline (all microseconds), released immediately. A period of 0 makes proc
+ * a normal process again. proc must not be running.
+ */
+void edfSetParams(procPtr proc, int period, int budget, int deadline)
+{
+    // Take proc off whichever run queue it is on; it is put back below
+    int wasQueued = proc->status == STATUS_READY && proc != Current;
+    if (wasQueued)
+    {
+        schedDequeue(proc);
+    }
+
+    if (!IS_REAL_TIME(proc) && period > 0)
+    {
+        proc->nextRTProcPtr = RealTimeProcs;
+        RealTimeProcs = proc;
+    }
+    else if (IS_REAL_TIME(proc) && period == 0)
+    {
+        edfRemove(proc);
+    }
+
+    proc->rtPeriod = period;
+    proc->rtBudget = budget;
+    proc->rtDeadline = deadline;
+    if (period > 0)
+    {
+        int now = readKernelTime();
+        proc->rtNextRelease = now;
+        release(proc, now);
+    }
+
+    if (wasQueued)
+    {
+        schedRequeue(proc);
+    }
+}
+
+/*
+ * Returns 1 iff some real-time process is waiting for its next period.
+ */
+int edfThrottled(void)
+{
+    for (procPtr rt = RealTimeProcs; rt != NULL; rt = rt->nextRTProcPtr)
+    {
+        if (rt->status == STATUS_THROTTLED)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Removes proc from the list of real-time processes, and from the deadline
+ * queue if it is runnable. Called when proc quits or stops being real-time.
+ */
+void edfRemove(procPtr proc)
+{
+    heapRemove(&DeadlineQueue, proc);
+    if (RealTimeProcs == proc)
+    {
+        RealTimeProcs = proc->nextRTProcPtr;
+    }
+    else
+    {
+        for (procPtr rt = RealTimeProcs; rt != NULL; rt = rt->nextRTProcPtr)
+        {
+            if (rt->nextRTProcPtr == proc)
+            {
+                rt->nextRTProcPtr = proc->nextRTProcPtr;
+                break;
+            }
+        }
+    }
+    proc->nextRTProcPtr = NULL;
+    if (proc->status == STATUS_THROTTLED)
+    {
+        proc->status = STATUS_READY;
+        Sched->enqueue(proc);
+    }
+}
+
+/*
+ * Starts the period of proc that contains currentTime: refills its budget,
+ * sets its new absolute deadline and lets it run again if it was throttled.
+ * Whole periods that were missed are skipped.
+ */
+static void release(procPtr proc, int currentTime)
+{
+    int releaseTime = proc->rtNextRelease;
+    while (proc->rtNextRelease <= currentTime)
+    {
+        releaseTime = proc->rtNextRelease;
+        proc->rtNextRelease += proc->rtPeriod;
+    }
+    // CPU time the running proc used before the boundary belongs to the old
+    // period, so charge it now rather than against the new budget
+    if (proc == Current && currentTime > proc->startTime)
+    {
+        int deltaTime = currentTime - proc->startTime;
+        proc->CPUTime += deltaTime;
+        schedCharge(proc, deltaTime);
+        proc->startTime = currentTime;
+    }
+    proc->rtBudgetLeft = proc->rtBudget;
+    proc->rtAbsDeadline = releaseTime + proc->rtDeadline;
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("release(): Releasing process %d with deadline %d.\n", proc->pid, proc->rtAbsDeadline);
+    }
+
+    if (proc->status == STATUS_THROTTLED)
+    {
+        proc->status = STATUS_READY;
+        edfEnqueue(proc);
+    }
+    else if (heapContains(&DeadlineQueue, proc))
+    {
+        // The deadline changed, so re-sort proc
+        edfDequeue(proc);
+        edfEnqueue(proc);
+    }
+}
@@ -0,0 +1,212 @@
+/* ------------------------------------------------------------------------
+   heap.c
+   Defines functions that manipulate an intrusive pairing heap of processes.
+   The heap links live in the heapChildPtr/heapSiblingPtr/heapPrevPtr fields
+   of procStruct, so no memory is allocated. Insertion is constant time and
+   removing the minimum (or any process) is amortized logarithmic. Processes
+   with equal keys are removed in the order they were inserted.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#include "heap.h"
+#include <stdlib.h>
+
+/* ------------------------- Prototypes ----------------------------------- */
+static int lessThan(procPtr, procPtr);
+static procPtr meld(procPtr, procPtr);
+static procPtr mergePairs(procPtr);
+static void detach(procPtr);
+
+
+/* -------------------------- Functions ----------------------------------- */
+/*
+ * Initializes a heap. Must be called on any heap before it can be used.
+ */
+void initHeap(heapPtr heap)
+{
+    heap->root = NULL;
+    heap->size = 0;
+    heap->nextSeq = 0;
+}
+
+/*
+ * Adds proc to heap with the given key. proc must not already be on a heap.
+ */
+void heapInsert(heapPtr heap, procPtr proc, long long key)
+{
+    proc->heapKey = key;
+    proc->heapSeq = heap->nextSeq++;
+    proc->heapChildPtr = NULL;
+    proc->heapSiblingPtr = NULL;
+    proc->heapPrevPtr = NULL;
+    proc->onHeap = heap;
+    heap->root = meld(heap->root, proc);
+    heap->size++;
+}
+
+/*
+ * Returns the process with the smallest key in heap without removing it, or
+ * NULL if heap is empty.
+ */
+procPtr heapPeekMin(heapPtr heap)
+{
+    return heap->root;
+}
+
+/*
+ * Removes and returns the process with the smallest key in heap. Returns NULL
+ * iff heap is empty.
+ */
+procPtr heapRemoveMin(heapPtr heap)
+{
+    procPtr min = heap->root;
+    if (min == NULL)
+    {
+        return NULL;
+    }
+    heap->root = mergePairs(min->heapChildPtr);
+    if (heap->root != NULL)
+    {
+        heap->root->heapPrevPtr = NULL;
+    }
+    min->heapChildPtr = NULL;
+    min->onHeap = NULL;
+    heap->size--;
+    return min;
+}
+
+/*
+ * Removes proc from wherever it is in heap. Does nothing if proc is not on
+ * heap.
+ */
+void heapRemove(heapPtr heap, procPtr proc)
+{
+    if (!heapContains(heap, proc))
+    {
+        return;
+    }
+    if (proc == heap->root)
+    {
+        heapRemoveMin(heap);
+        return;
+    }
+    detach(proc);
+    heap->root = meld(heap->root, mergePairs(proc->heapChildPtr));
+    proc->heapChildPtr = NULL;
+    proc->onHeap = NULL;
+    heap->size--;
+}
+
+/*
+ * Returns 1 if proc is currently on heap, 0 otherwise.
+ */
+int heapContains(heapPtr heap, procPtr proc)
+{
+    return heap != NULL && proc->onHeap == heap;
+}
+
+/*
+ * Returns true iff a should come out of the heap before b.
+ */
+static int lessThan(procPtr a, procPtr b)
+{
+    if (a->heapKey != b->heapKey)
+    {
+        return a->heapKey < b->heapKey;
+    }
+    return a->heapSeq < b->heapSeq;
+}
+
+/*
+ * Melds two heap-ordered trees and returns the root of the result. Either
+ * tree may be NULL. The roots must have no siblings.
+ */
+static procPtr meld(procPtr a, procPtr b)
+{
+    if (a == NULL)
+    {
+        return b;
+    }
+    if (b == NULL)
+    {
+        return a;
+    }
+    if (lessThan(b, a))
+    {
+        procPtr tmp = a;
+        a = b;
+        b = tmp;
+    }
+    // b becomes the first child of a
+    b->heapPrevPtr = a;
+    b->heapSiblingPtr = a->heapChildPtr;
+    if (a->heapChildPtr != NULL)
+    {
+        a->heapChildPtr->heapPrevPtr = b;
+    }
+    a->heapChildPtr = b;
+    a->heapSiblingPtr = NULL;
+    a->heapPrevPtr = NULL;
+    return a;
+}
+
+/*
+ * Combines a list of sibling trees into one tree using the standard two-pass
+ * pairing, and returns its root.
+ */
+static procPtr mergePairs(procPtr first)
+{
+    procPtr pairs = NULL;
+
+    // First pass: meld siblings left to right in pairs, stacking the results
+    while (first != NULL)
+    {
+        procPtr a = first;
+        procPtr b = a->heapSiblingPtr;
+        first = (b == NULL) ? NULL : b->heapSiblingPtr;
+        a->heapSiblingPtr = NULL;
+        if (b != NULL)
+        {
+            b->heapSiblingPtr = NULL;
+        }
+        procPtr melded = meld(a, b);
+        melded->heapSiblingPtr = pairs;
+        pairs = melded;
+    }
+
+    // Second pass: meld the stacked pairs right to left
+    procPtr root = NULL;
+    while (pairs != NULL)
+    {
+        procPtr next = pairs->heapSiblingPtr;
+        pairs->heapSiblingPtr = NULL;
+        root = meld(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+/*
+ * Cuts the subtree rooted at proc out of its parent's child list. proc must
+ * not be the root of its heap.
+ */
+static void detach(procPtr proc)
+{
+    procPtr prev = proc->heapPrevPtr;
+    if (prev->heapChildPtr == proc)
+    {
+        prev->heapChildPtr = proc->heapSiblingPtr;
+    }
+    else
+    {
+        prev->heapSiblingPtr = proc->heapSiblingPtr;
+    }
+    if (proc->heapSiblingPtr != NULL)
+    {
+        proc->heapSiblingPtr->heapPrevPtr = prev;
+    }
+    proc->heapSiblingPtr = NULL;
+    proc->heapPrevPtr = NULL;
+}
@@ -0,0 +1,33 @@
+/* ------------------------------------------------------------------------
+   heap.h
+   Header for heap.c. Contains the typedef for an intrusive pairing heap of
+   procStructs ordered by a per-process key. Include this file for access to
+   the heap manipulation functions.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#ifndef _HEAP_H
+#define _HEAP_H
+
+#include "kernel.h"
+
+typedef struct procHeap procHeap;
+typedef struct procHeap * heapPtr;
+
+struct procHeap
+{
+    procPtr root;
+    int size;
+    long nextSeq;       // Insertion counter, so that equal keys come out FIFO
+};
+
+void initHeap(heapPtr);
+void heapInsert(heapPtr, procPtr, long long);
+procPtr heapRemoveMin(heapPtr);
+procPtr heapPeekMin(heapPtr);
+void heapRemove(heapPtr, procPtr);
+int heapContains(heapPtr, procPtr);
+
+#endif /* _HEAP_H */
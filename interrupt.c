@@ -1,11 +1,35 @@
 #include "phase1.h"
+#include "kernel.h"
+#include "sched.h"
+#include "phase1utility.h"
+#include "timer.h"
+
+extern kernelStats KernelStats;
+extern procPtr Current;
 
 /*
- * Interrupt handler for the clock device.
+ * Interrupt handler for the clock device. Runs the callouts that are due, then
+ * checks the time slice. In tickless mode the time slice check is skipped
+ * entirely while no other process could take the CPU. The clock is only read
+ * if there are callouts to run or a time slice to check.
  */
 void clockHandler(int interruptType, void *arg)
 {
+    KernelStats.clockInterrupts++;
+    forgetKernelTime();
+    if (calloutsPending() > 0)
+    {
+        runCallouts(readKernelTime());
+    }
+    if (TICKLESS && Current != NULL && !schedNeedsTick(Current))
+    {
+        KernelStats.skippedTicks++;
+        // The interrupted code must not reuse the time read here
+        forgetKernelTime();
+        return;
+    }
     timeSlice();
+    forgetKernelTime();
 }
 
 void illegalIntHandler(int interruptType, void *arg)
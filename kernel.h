@@ -2,42 +2,109 @@
 #define _KERNEL_H
 
 #include "phase1.h"
+#include "timer.h"
 
 /* Patrick's DEBUG printing constant... */
 #define DEBUG 1
 
 typedef struct procStruct procStruct;
 typedef struct procStruct * procPtr;
+struct priorityQueue;
+struct procHeap;
 
 struct procStruct
 {
-    procPtr         nextProcPtr;             // Linked list ptr used by the ready list
+    procPtr         nextProcPtr;             // Linked list ptrs used by the ready list
+    procPtr         prevProcPtr;
+    struct priorityQueue *onQueue;           // The priority queue this proc is on, or NULL if none
+    int             queueLevel;              // Index of the FIFO within onQueue holding this proc
+
+    procPtr         heapChildPtr;            // Pairing heap links used by the heap-based schedulers
+    procPtr         heapSiblingPtr;
+    procPtr         heapPrevPtr;             // Parent if this is a first child, otherwise the previous sibling
+    struct procHeap *onHeap;                 // The heap this proc is on, or NULL if none
+    long long       heapKey;                 // Sort key within onHeap (64 bits even where long is 32)
+    long            heapSeq;                 // Tie breaker for equal keys
 
     procPtr         childProcPtr;            // Linked list storing this proc's children
+    procPtr         lastChildPtr;            // Youngest child, so forks append in constant time
     procPtr         nextSiblingPtr;
+    procPtr         prevSiblingPtr;
+    int             numKids;                 // Length of the child list
 
     procPtr         quitChildPtr;            // Linked list storing this proc's quit children
+    procPtr         lastQuitChildPtr;
     procPtr         nextQuitSiblingPtr;
 
     procPtr         procThatZappedMe;        // Linked list of procs that have zapped this proc
     procPtr         nextSiblingThatZapped;
+    procPtr         zapTargetPtr;            // The proc this proc is blocked zapping, if any
+
+    procPtr         nextBlockedPtr;          // Linked list of procs blocked in blockMe(), oldest first
+    procPtr         prevBlockedPtr;
 
     procPtr         parentPtr;               // The parent of this process
     char            name[MAXNAME];           // process's name
     char            startArg[MAXARG];        // args passed to process
     USLOSS_Context  state;                   // current context for process
-    short           pid;                     // process id
+    int             pid;                     // process id
+    int             handle;                  // pid while this proc exists, otherwise NO_HANDLE(slot)
     int             priority;                // process priority
+    int             basePriority;            // priority given to fork1(); MLFQ levels are relative to it
+    int             agedFrom;                // priority before aging raised it, or 0 if not aged
+    int             readySince;              // The time this proc last became ready to run (microseconds)
+    int             lastAged;                // The time this proc was queued or last raised by aging
+    int             boostedFrom;             // priority before priority inheritance raised it, or 0 if not boosted
     int (* startFunc) (char *);              // function where this process begins
     char           *stack;                   // call stack for this process
     unsigned int    stackSize;
+    int             stackHighWater;          // Stack bytes this proc used, measured when it quit
+    int             lightweight;             // Runs on the shared stack instead of its own (forkLight())
+    char           *sharedStackLow;          // Lowest address of its frames when it last left the shared stack, or NULL if it has not run
+    char           *savedStack;              // Copy of its frames while another lightweight proc has the shared stack
+    int             savedStackCapacity;
+    int             sharedStackDepth;        // Most bytes of the shared stack it has used
     int             status;                  // the current status of this proc (blocked, ready, etc)
     int             quitStatus;              // the exit status of this proc, if it has already quit
     int             startTime;               // The time at which this process last started executing (microseconds).
+    int             tickets;                 // Share of the CPU under the stride scheduler
+    long            pass;                    // Stride scheduler virtual time
+    long            vruntime;                // CFS scheduler weighted CPU time (microseconds)
+    int             burstTime;               // CPU time used since this proc last blocked (microseconds)
+    int             burstEstimate;           // Predicted length of this proc's CPU bursts (microseconds)
+    int             rtPeriod;                // Real-time period (microseconds), or 0 for a normal process
+    int             rtBudget;                // CPU time allowed per real-time period (microseconds)
+    int             rtDeadline;              // Deadline relative to each release (microseconds)
+    int             rtBudgetLeft;            // Budget left in the current period
+    int             rtAbsDeadline;           // Absolute deadline of the current period
+    int             rtNextRelease;           // The time at which the next period starts
+    procPtr         nextRTProcPtr;           // Linked list of all real-time procs
+    int             timeSliceOverride;       // This proc's quantum (microseconds), or 0 to use its priority's quantum
+    int             donatedSlice;            // Rest of a quantum handed over by yieldTo(), or 0 if none
+    callout         sleepCallout;            // Wakes this proc from sleepFor()/sleepUntil()
     long            CPUTime;                 // The amount of time this process has run (microseconds)
     int             isZapped;                // Has this proces been zapped?
 };
 
+typedef struct kernelStats kernelStats;
+
+// Counters kept by the kernel and printed by dumpStats()
+struct kernelStats
+{
+    long            contextSwitches;         // dispatches that switched to a different process
+    long            elidedSwitches;          // dispatches that kept the running process
+    long            clockInterrupts;         // calls to clockHandler()
+    long            clockReads;              // USLOSS_DeviceInput() calls on the clock device
+    long            skippedTicks;            // clock interrupts that skipped timeSlice() in tickless mode
+    long            avoidedDispatches;       // kernel calls that made a process runnable without a dispatch
+    long            agingBoosts;             // times aging raised a waiting process one priority
+    long            calloutsRun;             // kernel callouts run by the clock interrupt
+    long            stacksReused;            // stacks fork1() took from the stack pool
+    long            stackCopies;             // times a lightweight proc's frames were copied on or off the shared stack
+    long            stackBytesCopied;
+    int             maxReadyWait;            // longest any process has waited to run (microseconds)
+};
+
 struct psrBits
 {
     unsigned int curMode:1;
@@ -55,12 +122,43 @@ union psrValues
 
 /* Some useful constants.  Add more as needed... */
 #define NO_CURRENT_PROCESS NULL
-#define MINPRIORITY 5
+// Number of ready list priority levels, sentinel included. Override at build
+// time with -DPRIORITY_LEVELS=n (for example 8, 64 or 256).
+#ifndef PRIORITY_LEVELS
+#define PRIORITY_LEVELS 6
+#endif
+#define MINPRIORITY (PRIORITY_LEVELS - 1)
 #define MAXPRIORITY 1
 #define SENTINELPID 1
-#define SENTINELPRIORITY (MINPRIORITY + 1)
+#define SENTINELPRIORITY PRIORITY_LEVELS
 #define MAX_TIME_SLICE 80000
 
+// Aging: a process waiting this long (microseconds) on the ready list is raised
+// one priority by the default scheduler; 0 disables aging. Build with -DAGING_THRESHOLD=n.
+#ifndef AGING_THRESHOLD
+#define AGING_THRESHOLD 0
+#endif
+
+// Priority inheritance: processes being zapped or joined run at least at the
+// priority of the processes waiting on them. Build with -DPRIORITY_INHERITANCE=1.
+#ifndef PRIORITY_INHERITANCE
+#define PRIORITY_INHERITANCE 0
+#endif
+
+// Tickless mode: clockHandler() skips timeSlice() while nothing could preempt
+// the running process. Build with -DTICKLESS=0 to tick on every interrupt.
+#ifndef TICKLESS
+#define TICKLESS 1
+#endif
+
+#define STRIDE1 (1 << 20)          // Stride of a process holding a single ticket
+#define DEFAULT_TICKETS(priority) (100 * (SENTINELPRIORITY - (priority)))
+#define CFS_WEIGHT(priority) (1024 * (SENTINELPRIORITY - (priority)))
+#define CFS_MIN_GRANULARITY 20000  // Shortest run (microseconds) the CFS scheduler will preempt
+#define BURST_INITIAL_ESTIMATE 20000  // Predicted CPU burst (microseconds) of a new process
+#define BURST_WEIGHT 50            // Percent weight of the latest burst in the next burst estimate
+#define MLFQ_BOOST_PERIOD 1000000  // How often (microseconds) all processes return to their base priority
+
 // Status codes
 #define STATUS_EMPTY -1        // This process has never been initialized
 #define STATUS_READY 0         // Should be on the ready list.
@@ -68,8 +166,24 @@ union psrValues
 #define STATUS_QUIT 2          // This process has quit.
 #define STATUS_BLOCKED_JOIN 4  // Blocked waiting for a child to quit.
 #define STATUS_DEAD 5          // This process has quit and has been joined by its parent.
+#define STATUS_THROTTLED 6     // Real-time process that has used its budget, waiting for its next period.
+#define STATUS_SLEEPING 7      // Waiting in sleepFor() or sleepUntil() for a time to pass.
 
 #define PID_NEVER_EXISTED -1
+
+// Most processes that can exist at once. The process table grows to this size
+// a chunk of PROC_CHUNK_SIZE entries at a time.
+#ifndef MAX_PROCESSES
+#define MAX_PROCESSES MAXPROC
+#endif
+#define PROC_CHUNK_BITS 6
+#define PROC_CHUNK_SIZE (1 << PROC_CHUNK_BITS)
+#define PROC_CHUNK_MASK (PROC_CHUNK_SIZE - 1)
+#define PROC_CHUNKS ((MAX_PROCESSES + PROC_CHUNK_SIZE - 1) / PROC_CHUNK_SIZE)
+
+// The handle of a process table entry that holds no process. It is a pid
+// that hashes to a different slot, so no lookup can match it.
+#define NO_HANDLE(slot) ((slot) == 0 ? 1 : 0)
 #define NO_PARENT -2
 
 #endif
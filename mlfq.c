@@ -0,0 +1,168 @@
+/* ------------------------------------------------------------------------
+   mlfq.c
+   Multilevel feedback queue scheduler policy. The priority passed to fork1()
+   becomes a process's base level. A process that uses its whole time slice
+   is demoted one level, a process that gave up the CPU by blocking is
+   promoted one level back toward its base when it wakes up, and every
+   MLFQ_BOOST_PERIOD microseconds all processes are returned to their base
+   level so that demoted processes cannot starve.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+
+   ------------------------------------------------------------------------ */
+
+#include "sched.h"
+#include "queue.h"
+#include "phase1utility.h"
+
+extern int ProcTableSize;
+extern priorityQueue ReadyList;
+extern int debugflag;
+
+static void mlfqInit(void);
+static void mlfqEnqueue(procPtr);
+static void mlfqDequeue(procPtr);
+static procPtr mlfqPickNext(void);
+static int mlfqTick(procPtr, int);
+static void mlfqWakeup(procPtr);
+static int mlfqContended(procPtr);
+static int mlfqPreempts(procPtr, procPtr);
+static void checkBoost(int);
+static void setLevel(procPtr, int);
+
+// The time (in microseconds) at which all processes were last boosted
+static int lastBoostTime = 0;
+
+schedOps MLFQOps =
+{
+    "mlfq",
+    mlfqInit,
+    mlfqEnqueue,
+    mlfqDequeue,
+    mlfqPickNext,
+    mlfqTick,
+    mlfqWakeup,
+    noCharge,
+    mlfqContended,
+    mlfqPreempts,
+    noPicked,
+};
+
+static void mlfqInit(void)
+{
+    initPriorityQueue(&ReadyList);
+    lastBoostTime = 0;
+}
+
+static void mlfqEnqueue(procPtr proc)
+{
+    addProc(&ReadyList, proc);
+}
+
+static void mlfqDequeue(procPtr proc)
+{
+    unlinkProc(&ReadyList, proc);
+}
+
+static procPtr mlfqPickNext(void)
+{
+    return removeProc(&ReadyList);
+}
+
+/*
+ * Boosts everyone if it is time to, then preempts proc if it has used its
+ * whole time slice, moving it one level down (but never below MINPRIORITY).
+ */
+static int mlfqTick(procPtr proc, int currentTime)
+{
+    checkBoost(currentTime);
+    if (currentTime - proc->startTime <= getTimeSlice(proc))
+    {
+        return 0;
+    }
+    if (proc->basePriority != SENTINELPRIORITY && proc->priority < MINPRIORITY)
+    {
+        if (DEBUG && debugflag)
+        {
+            USLOSS_Console("mlfqTick(): Demoting process %d to priority %d.\n", proc->pid, proc->priority + 1);
+        }
+        setLevel(proc, proc->priority + 1);
+    }
+    return 1;
+}
+
+/*
+ * proc gave up the CPU by blocking, so move it one level back up toward its
+ * base priority before making it runnable.
+ */
+static void mlfqWakeup(procPtr proc)
+{
+    if (proc->priority > proc->basePriority)
+    {
+        setLevel(proc, proc->priority - 1);
+    }
+    addProc(&ReadyList, proc);
+}
+
+/*
+ * Demotion can put proc below any waiting process, so every waiting process
+ * other than the sentinel competes with it.
+ */
+static int mlfqContended(procPtr proc)
+{
+    int highest = highestReadyPriority(&ReadyList);
+    return highest != -1 && (highest < SENTINELPRIORITY || proc->priority == SENTINELPRIORITY);
+}
+
+/*
+ * A process at the running process's level or higher runs first.
+ */
+static int mlfqPreempts(procPtr proc, procPtr running)
+{
+    return proc->priority <= running->priority;
+}
+
+/*
+ * Returns every process to its base priority if MLFQ_BOOST_PERIOD has passed
+ * since the last boost.
+ */
+static void checkBoost(int currentTime)
+{
+    if (currentTime - lastBoostTime < MLFQ_BOOST_PERIOD)
+    {
+        return;
+    }
+    lastBoostTime = currentTime;
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("checkBoost(): Boosting all processes to their base priority.\n");
+    }
+    for (int slot = 0; slot < ProcTableSize; slot++)
+    {
+        procPtr proc = slotToProc(slot);
+        if (proc->pid != PID_NEVER_EXISTED && proc->status != STATUS_DEAD && proc->priority != proc->basePriority)
+        {
+            setLevel(proc, proc->basePriority);
+        }
+    }
+}
+
+/*
+ * Changes the priority of proc to level, moving it to the matching level of
+ * the ready list if it is currently waiting there.
+ */
+static void setLevel(procPtr proc, int level)
+{
+    if (containsProc(&ReadyList, proc))
+    {
+        unlinkProc(&ReadyList, proc);
+        proc->priority = level;
+        addProc(&ReadyList, proc);
+    }
+    else
+    {
+        proc->priority = level;
+    }
+}
@@ -11,6 +11,9 @@
 #include "phase1utility.h"
 #include "queue.h"
 #include "interrupt.h"
+#include "sched.h"
+#include "stack.h"
+#include "sharedstack.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -23,23 +26,37 @@ void launch();
 int sentinel (char *);
 extern int start1 (char *);
 static void checkDeadlock();
+static int forkProc(char *, int (*)(char *), char *, int, int, int);
 
 /* -------------------------- Globals ------------------------------------- */
 // Patrick's debugging global variable...
 int debugflag = 0;
 
-// the process table
-procStruct ProcTable[MAXPROC];
+// the process table, allocated a chunk at a time. Entries never move, so a
+// procPtr stays valid as the table grows.
+procPtr ProcTable[PROC_CHUNKS];
+
+// the number of process table entries in the allocated chunks
+int ProcTableSize = 0;
+
+// the number of processes that exist (see processExists())
+int NumProcs = 0;
 
 // Process lists
 priorityQueue ReadyList;
 
+// The quantum (microseconds) given to processes at each priority
+int TimeSliceTable[SENTINELPRIORITY];
+
 // current process ID
 procPtr Current = NULL;
 
 // the next pid to be assigned
 unsigned int nextPid = SENTINELPID;
 
+// counters reported by dumpStats()
+kernelStats KernelStats;
+
 /* -------------------------- Functions ----------------------------------- */
 /* ------------------------------------------------------------------------
    Name - startup
@@ -58,19 +75,21 @@ void startup(int argc, char *argv[])
     {
         USLOSS_Console("startup(): Initializing process table.\n");
     }
-    for (int i = 0; i < MAXPROC; i++)
-    {
-        ProcTable[i].pid = PID_NEVER_EXISTED;
-        ProcTable[i].priority = -1;
-        ProcTable[i].status = STATUS_EMPTY;
-    }
+    initProcTable();
 
-    // Initialize the Ready list
+    // Initialize the scheduler and its ready list
     if (DEBUG && debugflag)
     {
         USLOSS_Console("startup(): Initializing the ready list.\n");
     }
-    initPriorityQueue(&ReadyList);
+    initScheduler(SCHED_POLICY);
+    initCallouts(readKernelTime());
+
+    // Every priority starts out with the default quantum
+    for (int i = 0; i < SENTINELPRIORITY; i++)
+    {
+        TimeSliceTable[i] = MAX_TIME_SLICE;
+    }
 
     // Initialize the clock interrupt handler
     if (DEBUG && debugflag)
@@ -141,20 +160,53 @@ void finish(int argc, char *argv[])
                   process information changed
    ------------------------------------------------------------------------ */
 int fork1(char *name, int (*startFunc)(char *), char *arg, int stacksize, int priority)
+{
+    // ensure that we are in kernel mode
+    checkMode("fork1");
+
+    return forkProc(name, startFunc, arg, stacksize, priority, 0);
+} /* fork1 */
+
+/* ------------------------------------------------------------------------
+   Name - forkLight
+   Purpose - Creates a lightweight process. It runs on a stack shared with
+             the other lightweight processes, and its frames are copied off
+             and back on when another of them needs the stack, so it uses
+             only as much memory as its stack is deep.
+   Parameters - the process procedure address and the priority to be
+                assigned to the child process.
+   Returns - the process id of the created child or -1 if no child could
+             be created or if priority is not between max and min priority.
+   Side Effects - as for fork1
+   ------------------------------------------------------------------------ */
+int forkLight(char *name, int (*startFunc)(char *), char *arg, int priority)
+{
+    // ensure that we are in kernel mode
+    checkMode("forkLight");
+
+    return forkProc(name, startFunc, arg, 0, priority, 1);
+} /* forkLight */
+
+/* ------------------------------------------------------------------------
+   Name - forkProc
+   Purpose - Does the work of fork1 and forkLight.
+   Parameters - as for fork1, and whether the process is lightweight, in
+                which case stacksize is ignored.
+   Returns - as for fork1
+   Side Effects - as for fork1
+   ------------------------------------------------------------------------ */
+static int forkProc(char *name, int (*startFunc)(char *), char *arg, int stacksize, int priority, int lightweight)
 {
     if (DEBUG && debugflag)
     {
         USLOSS_Console("fork1(): Creating process %s.\n", name);
     }
 
-    // ensure that we are in kernel mode
-    checkMode("fork1");
-
     // disable interrupts
     disableInterrupts();
 
     // Return if stack size is too small
-    if (stacksize < USLOSS_MIN_STACK)
+    if (!lightweight && stacksize < USLOSS_MIN_STACK)
     {
         if (DEBUG && debugflag)
         {
@@ -191,12 +243,23 @@ int fork1(char *name, int (*startFunc)(char *), char *arg, int stacksize, int pr
     {
         USLOSS_Console("fork1(): slot found is %d\n", slot);
     }
-    procPtr proc = &ProcTable[slot];
-    if (initProc(Current, proc, name, startFunc, arg, stacksize, priority, pid) == -1)
+    if (!growProcTable(slot))
+    {
+        if (DEBUG && debugflag)
+        {
+            USLOSS_Console("fork1(): Could not grow the process table.\n");
+        }
+        enableInterrupts();
+        return -1;
+    }
+    procPtr proc = slotToProc(slot);
+    if (initProc(Current, proc, name, startFunc, arg, stacksize, priority, pid, lightweight) == -1)
     {
         enableInterrupts();
         return -1;
     }
+    claimPid(pid);
+    NumProcs++;
 
     // Add the new proc to Current's child list
     if (DEBUG && debugflag && Current != NULL)
@@ -217,20 +280,20 @@ int fork1(char *name, int (*startFunc)(char *), char *arg, int stacksize, int pr
     {
         USLOSS_Console("fork1(): Adding process to the ready list.\n");
     }
-    addProc(&ReadyList, proc);
+    schedEnqueue(proc);
 
-    // Call the dispatcher
+    // Call the dispatcher if the new process should run before this one
     if (priority != SENTINELPRIORITY)
     {
         if (DEBUG && debugflag)
         {
-            USLOSS_Console("fork1(): Calling the dispatcher.\n");
+            USLOSS_Console("fork1(): Calling the dispatcher if needed.\n");
         }
-        dispatcher();
+        reschedIfNeeded(1);
     }
     enableInterrupts();
     return pid;
-} /* fork1 */
+} /* forkProc */
 
 /* ------------------------------------------------------------------------
    Name - launch
@@ -301,8 +364,9 @@ int join(int *status)
             USLOSS_Console("join(): Process %d has no quit children. Blocking.\n", Current->pid);
         }
 
-        // This process must block and wait
+        // This process must block and wait, lending its priority to its children
         Current->status = STATUS_BLOCKED_JOIN;
+        updateChildrenInheritedPriority(Current);
         // Switch to another process. When we switch back, we'll jump in after dispatcher().
         dispatcher();
 
@@ -333,13 +397,13 @@ int join(int *status)
     }
 
     // Mark the quit child as dead
-    quitChild->status = STATUS_DEAD;
+    markDead(quitChild);
     
     if (DEBUG && debugflag)
     {
         USLOSS_Console("join(): Removing quit child from child list.\n");
     }
-    removeDeadChildren(Current);
+    removeChild(Current, quitChild);
 
     enableInterrupts();
 
@@ -377,7 +441,7 @@ void quit(int status)
             USLOSS_Console("quit(): process %d, '%s', has active children. Halting...\n", Current->pid, Current->name);
             USLOSS_Halt(1);
         }
-        childPtr->status = STATUS_DEAD;
+        markDead(childPtr);
         childPtr = childPtr->nextSiblingPtr;
     }
 
@@ -388,6 +452,25 @@ void quit(int status)
     }
     Current->status = STATUS_QUIT;
     Current->quitStatus = status;
+    if (STACK_HIGH_WATER)
+    {
+        if (Current->lightweight)
+        {
+            Current->stackHighWater = sharedStackUse(Current);
+        }
+        else
+        {
+            Current->stackHighWater = stackHighWater(Current->stack, Current->stackSize);
+        }
+        recordStackUse(Current->name, Current->stackHighWater, Current->stackSize);
+    }
+
+    // Drop any priority this process inherited
+    if (Current->boostedFrom != 0)
+    {
+        Current->priority = Current->boostedFrom;
+        Current->boostedFrom = 0;
+    }
 
     // Notify parent that this process has quit
     procPtr parentPtr = Current->parentPtr;
@@ -407,13 +490,19 @@ void quit(int status)
                 USLOSS_Console("quit(): Parent was blocked on join. Unblocking.\n");
             }
             parentPtr->status = STATUS_READY;
-            addProc(&ReadyList, parentPtr);
+            schedWakeup(parentPtr);
+
+            // The parent no longer waits on its other children
+            updateChildrenInheritedPriority(parentPtr);
         }
     }
 
     // Unblock the processes that zapped this process
     unblockProcessesThatZappedThisProcess(Current);
 
+    // Drop any scheduler state for this process
+    schedQuit(Current);
+
     // For future phases
     p1_quit(Current->pid);
 
@@ -430,7 +519,8 @@ void quit(int status)
    Purpose - dispatches ready processes.  The process with the highest
              priority (the first on the ready list) is scheduled to
              run.  The old process is swapped out and the new process
-             swapped in.
+             swapped in.  If the old process is chosen again, no
+             switch is made and it simply starts a new time slice.
    Parameters - none
    Returns - nothing
    Side Effects - the context of the machine is changed
@@ -439,16 +529,21 @@ void dispatcher(void)
 {
     checkMode("dispatcher");
     disableInterrupts();
+    NeedResched = 0;
 
     // Add the runnning time (in microseconds) to the last process
+    int currentTime = readKernelTime();
     if (Current != NULL)
     {
-        int deltaTime = getCurrentTime() - Current->startTime;
+        int deltaTime = currentTime - Current->startTime;
         if (DEBUG && debugflag)
         {
             USLOSS_Console("dispatcher(): Adding %d microseconds to CPUTime for process %d.\n", deltaTime, Current->pid);
         }
         Current->CPUTime += deltaTime;
+        schedCharge(Current, deltaTime);
+        // A donated quantum only lasts until the process gives up the CPU
+        Current->donatedSlice = 0;
     }
     // Put the old process back on the ready list, if appropriate.
     if (Current != NULL && Current->status == STATUS_READY)
@@ -457,14 +552,14 @@ void dispatcher(void)
         {
             USLOSS_Console("dispatcher(): The old process is still ready. Re-adding to ready list.\n");
         }
-        addProc(&ReadyList, Current);
+        schedEnqueue(Current);
     }
     if(DEBUG && debugflag)
     {
         printPriorityQueue(&ReadyList);
     }
     // Get the next process from the ready list
-    procPtr nextProcess = removeProc(&ReadyList);
+    procPtr nextProcess = schedPickNext();
     if (nextProcess == NULL)
     {
         if (DEBUG && debugflag)
@@ -478,6 +573,20 @@ void dispatcher(void)
         USLOSS_Console("dispatcher(): Next process is process %d.\n", nextProcess->pid);
     }
 
+    // If the old process is still the best choice, just restart its time slice
+    if (nextProcess == Current)
+    {
+        if (DEBUG && debugflag)
+        {
+            USLOSS_Console("dispatcher(): Process %d keeps running. Eliding context switch.\n", Current->pid);
+        }
+        KernelStats.elidedSwitches++;
+        Current->startTime = currentTime;
+        enableInterrupts();
+        return;
+    }
+    KernelStats.contextSwitches++;
+
     // Switch Contexts
     USLOSS_Context *old = NULL;
     if (Current != NULL)
@@ -486,7 +595,21 @@ void dispatcher(void)
     }
     USLOSS_Context *new = &(nextProcess->state);
 
-    enableInterrupts();
+    // Update the running start time for the new process
+    nextProcess->startTime = currentTime;
+
+    // A lightweight process leaves its frames on the shared stack. One whose
+    // frames are not there is switched to through the switcher, which enables
+    // interrupts once they are.
+    if (Current != NULL && Current->lightweight)
+    {
+        leaveSharedStack(Current, (char *) &currentTime);
+    }
+    int viaSwitcher = needsSharedStack(nextProcess);
+    if (!viaSwitcher)
+    {
+        enableInterrupts();
+    }
 
     if (Current != NULL)
     {
@@ -498,9 +621,14 @@ void dispatcher(void)
         p1_switch(Current->pid, nextProcess->pid);
     }
     Current = nextProcess;
-    // Update the running start time for the new Current
-    Current->startTime = getCurrentTime();
-    USLOSS_ContextSwitch(old, new);
+    if (viaSwitcher)
+    {
+        switchToShared(old, nextProcess);
+    }
+    else
+    {
+        USLOSS_ContextSwitch(old, new);
+    }
 } /* dispatcher */
 
 /* ------------------------------------------------------------------------
@@ -530,24 +658,25 @@ int sentinel (char *dummy)
 /* check to determine if deadlock has occurred... */
 static void checkDeadlock()
 {
-    int numProc = 2;  // Count the number of processes. Sentinel is the first
-    for (int slot = 0; slot < MAXPROC; slot++)
+    // The clock will release a throttled process or run a callout (such as
+    // waking a sleeping process), so neither is a deadlock
+    if (edfThrottled() || calloutsPending() > 0)
     {
-        // There is always sentinel and  start1
-        if (slot == 1 || slot == 2)
-        {
-            continue;
-        }
-        procPtr proc = &ProcTable[slot];
-        if (processExists(proc))
+        return;
+    }
+    int numProc = 2 + NumProcs;  // Count the number of processes. Sentinel is the first
+    // There is always sentinel and  start1
+    for (int slot = 1; slot <= 2 && slot < ProcTableSize; slot++)
+    {
+        if (processExists(slotToProc(slot)))
         {
-            if (DEBUG && debugflag)
-            {
-                USLOSS_Console("checkDeadlock(): process %d still exists\n", proc->pid);
-            }
-            numProc++;
+            numProc--;
         }
     }
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("checkDeadlock(): %d processes still exist\n", NumProcs);
+    }
     if(numProc > 2)
     {
         // The sentinel is called even though other procs exist.
@@ -31,6 +31,15 @@
 
 #define MAXSYSCALLS  50
 
+/*
+ * How the stacks of newly forked processes are committed (see setStackPolicy).
+ * STACK_LAZY stacks take memory as they are touched; STACK_PREFAULT stacks are
+ * resident before the process first runs.
+ */
+
+#define STACK_LAZY      0
+#define STACK_PREFAULT  1
+
 
 /* 
  * Function prototypes for this phase.
@@ -38,16 +47,30 @@
 
 extern int   fork1(char *name, int(*func)(char *), char *arg,
                    int stacksize, int priority);
+extern int   forkLight(char *name, int(*func)(char *), char *arg, int priority);
 extern int   join(int *status);
 extern void  quit(int status);
 extern int   zap(int pid);
 extern int   isZapped(void);
 extern int   getpid(void);
 extern void  dumpProcesses(void);
+extern void  dumpStats(void);
+extern void  dumpStackUsage(void);
 extern int   blockMe(int block_status);
 extern int   unblockProc(int pid);
+extern int   unblockProcs(int *pids, int n);
+extern int   unblockAll(int block_status);
 extern int   readCurStartTime(void);
 extern void  timeSlice(void);
+extern void  yield(void);
+extern int   yieldTo(int pid);
+extern int   sleepFor(int us);
+extern int   sleepUntil(int time);
+extern int   setTimeSlice(int pid, int timeSlice);
+extern int   setPriorityTimeSlice(int priority, int timeSlice);
+extern int   setTickets(int pid, int tickets);
+extern int   setDeadline(int pid, int period, int budget, int deadline);
+extern int   setStackPolicy(int policy);
 extern void  dispatcher(void);
 extern int   readtime(void);
 
@@ -4,11 +4,24 @@
 #include <string.h>
 #include <stdio.h>
 #include "phase1utility.h"
+#include "sched.h"
+#include "stack.h"
+#include "sharedstack.h"
+
+static bool canUnblock(procPtr);
+static void wakeBlockedProc(procPtr);
+static void wakeSleeper(void *);
+
+// The processes blocked in blockMe(), in the order they blocked
+static procPtr BlockedHead = NULL;
+static procPtr BlockedTail = NULL;
 
 extern procPtr Current;
-extern procStruct ProcTable[];
-extern priorityQueue ReadyList;
+extern int ProcTableSize;
+extern int TimeSliceTable[];
+extern kernelStats KernelStats;
 extern int debugflag;
+extern int StackPolicy;
 
 /*
  * This operation will block the calling process. newStatus is the value used to indicate the
@@ -35,6 +48,16 @@ int blockMe(int block_status)
         return -1;
     }
     Current->status = block_status;
+    Current->prevBlockedPtr = BlockedTail;
+    if (BlockedTail == NULL)
+    {
+        BlockedHead = Current;
+    }
+    else
+    {
+        BlockedTail->nextBlockedPtr = Current;
+    }
+    BlockedTail = Current;
     dispatcher();
     // Ensure we weren't zapped while waiting.
     if (Current->isZapped)
@@ -60,8 +83,8 @@ int unblockProc(int pid)
     disableInterrupts();
 
     //  Make sure everything is valid
-    procPtr process = &ProcTable[pidToSlot(pid)];
-    if(!processExists(process) || process->pid == Current->pid || process->status <= 10)
+    procPtr process = findProc(pid);
+    if(process == NULL || !canUnblock(process))
     {
         enableInterrupts();
         return -2;
@@ -71,13 +94,131 @@ int unblockProc(int pid)
         enableInterrupts();
         return -1;
     }
+    wakeBlockedProc(process);
+    // Call the dispatcher if the woken process should run before this one
+    reschedIfNeeded(1);
+    enableInterrupts();
+    return 0;
+}
+
+/*
+ * Unblocks each of the n processes in pids, as unblockProc() would, but puts
+ * them all on the Ready List before calling the dispatcher once. Entries that
+ * unblockProc() would reject are skipped.
+ * Return values:
+ * -2: if pids is NULL and n is positive.
+ * -1: if the calling process was zapped.
+ * otherwise, the number of processes unblocked.
+ */
+int unblockProcs(int *pids, int n)
+{
+    checkMode("unblockProcs");
+    disableInterrupts();
+
+    if (pids == NULL && n > 0)
+    {
+        enableInterrupts();
+        return -2;
+    }
+    if(Current->isZapped)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        procPtr process = findProc(pids[i]);
+        if (process != NULL && canUnblock(process))
+        {
+            wakeBlockedProc(process);
+            count++;
+        }
+    }
+    reschedIfNeeded(count);
+    enableInterrupts();
+    return count;
+}
+
+/*
+ * Unblocks every process that called blockMe() with block_status, in the order
+ * they blocked, then calls the dispatcher once. Only processes blocked in
+ * blockMe() are looked at, not the whole process table.
+ * Return values:
+ * -2: if block_status is less than or equal to 10.
+ * -1: if the calling process was zapped.
+ * otherwise, the number of processes unblocked.
+ */
+int unblockAll(int block_status)
+{
+    checkMode("unblockAll");
+    disableInterrupts();
+
+    if (block_status <= 10)
+    {
+        enableInterrupts();
+        return -2;
+    }
+    if(Current->isZapped)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    int count = 0;
+    procPtr next;
+    for (procPtr process = BlockedHead; process != NULL; process = next)
+    {
+        next = process->nextBlockedPtr;
+        if (process->status == block_status && canUnblock(process))
+        {
+            wakeBlockedProc(process);
+            count++;
+        }
+    }
+    reschedIfNeeded(count);
+    enableInterrupts();
+    return count;
+}
+
+/*
+ * Returns true iff process is blocked in blockMe() and may be unblocked by the
+ * current process.
+ */
+static bool canUnblock(procPtr process)
+{
+    return processExists(process) && process != Current && process->status > 10;
+}
+
+/*
+ * Makes the blocked process ready and puts it on the Ready List, without
+ * calling the dispatcher.
+ */
+static void wakeBlockedProc(procPtr process)
+{
+    // Take the process off the list of blockMe() waiters
+    if (process->prevBlockedPtr == NULL)
+    {
+        BlockedHead = process->nextBlockedPtr;
+    }
+    else
+    {
+        process->prevBlockedPtr->nextBlockedPtr = process->nextBlockedPtr;
+    }
+    if (process->nextBlockedPtr == NULL)
+    {
+        BlockedTail = process->prevBlockedPtr;
+    }
+    else
+    {
+        process->nextBlockedPtr->prevBlockedPtr = process->prevBlockedPtr;
+    }
+    process->nextBlockedPtr = NULL;
+    process->prevBlockedPtr = NULL;
+
     // Set the process's status to ready
     process->status = STATUS_READY;
     // Add the process to the readly list
-    addProc(&ReadyList, process);
-    // Call the dispatcher
-    dispatcher();
-    return 0;
+    schedWakeup(process);
 }
 
 /*
@@ -99,9 +240,9 @@ void timeSlice()
     checkMode("timeSlice");
     disableInterrupts();
 
-    int currentTime = getCurrentTime();
+    int currentTime = readKernelTime();
 
-    if (currentTime - Current->startTime > MAX_TIME_SLICE)
+    if (schedTick(Current, currentTime) || NeedResched)
     {
         dispatcher();
     }
@@ -110,12 +251,234 @@ void timeSlice()
 }
 
 /*
- * Return the CPU time (in milliseconds) used by the current process.
+ * Gives up the CPU without blocking. The calling process goes to the back of
+ * the Ready List and keeps running only if nothing else should run first.
+ */
+void yield(void)
+{
+    checkMode("yield");
+    disableInterrupts();
+
+    dispatcher();
+    enableInterrupts();
+}
+
+/*
+ * Gives up the CPU to process pid, which must be ready. It runs next with
+ * whatever is left of the caller's quantum, unless a real-time process is
+ * runnable. The caller goes back on the Ready List.
+ * Return values:
+ * -1: if pid does not exist, is not ready, is the caller or runs at
+ *     SENTINELPRIORITY.
+ *  0: otherwise.
+ */
+int yieldTo(int pid)
+{
+    checkMode("yieldTo");
+    disableInterrupts();
+
+    procPtr process = findProc(pid);
+    if (process == NULL || process == Current ||
+        process->status != STATUS_READY || process->priority == SENTINELPRIORITY)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    int left = getTimeSlice(Current) - (readKernelTime() - Current->startTime);
+    if (left > 0)
+    {
+        process->donatedSlice = left;
+    }
+    YieldTarget = process;
+    dispatcher();
+    enableInterrupts();
+    return 0;
+}
+
+/*
+ * Blocks the calling process until us microseconds from now. The process is
+ * off the Ready List while it sleeps and is woken by the clock interrupt, so
+ * the wake-up may come up to one clock tick late.
+ * Return values:
+ * -1: if the process was zapped before or while sleeping.
+ *  0: otherwise.
+ */
+int sleepFor(int us)
+{
+    checkMode("sleepFor");
+    disableInterrupts();
+
+    int result = sleepUntil(readKernelTime() + (us > 0 ? us : 0));
+    enableInterrupts();
+    return result;
+}
+
+/*
+ * Blocks the calling process until the clock reaches time (microseconds, as
+ * returned by USLOSS_DeviceInput() on the clock device). Returns at once if
+ * that time has passed.
+ * Return values:
+ * -1: if the process was zapped before or while sleeping.
+ *  0: otherwise.
+ */
+int sleepUntil(int time)
+{
+    checkMode("sleepUntil");
+    disableInterrupts();
+
+    if (Current->isZapped)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    if (time - readKernelTime() > 0)
+    {
+        Current->status = STATUS_SLEEPING;
+        addCallout(&Current->sleepCallout, time, wakeSleeper, Current);
+        dispatcher();
+    }
+    enableInterrupts();
+    return Current->isZapped ? -1 : 0;
+}
+
+/*
+ * Sets the quantum of process pid to timeSlice microseconds, overriding the
+ * quantum of its priority. A timeSlice of 0 removes the override.
+ * Return values:
+ * -1: if pid does not exist or timeSlice is negative.
+ *  0: otherwise.
+ */
+int setTimeSlice(int pid, int timeSlice)
+{
+    checkMode("setTimeSlice");
+    disableInterrupts();
+
+    procPtr process = findProc(pid);
+    if (process == NULL || timeSlice < 0)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    process->timeSliceOverride = timeSlice;
+    enableInterrupts();
+    return 0;
+}
+
+/*
+ * Sets the quantum given to every process at the given priority (unless it has
+ * its own override) to timeSlice microseconds.
+ * Return values:
+ * -1: if priority is out of range or timeSlice is not positive.
+ *  0: otherwise.
+ */
+int setPriorityTimeSlice(int priority, int timeSlice)
+{
+    checkMode("setPriorityTimeSlice");
+    if (priority < MAXPRIORITY || priority > SENTINELPRIORITY || timeSlice <= 0)
+    {
+        return -1;
+    }
+    TimeSliceTable[priority - 1] = timeSlice;
+    return 0;
+}
+
+/*
+ * Gives process pid the given number of tickets, which sets its share of the
+ * CPU under the stride scheduler.
+ * Return values:
+ * -1: if pid does not exist, runs at SENTINELPRIORITY or tickets is not
+ *     between 1 and STRIDE1.
+ *  0: otherwise.
+ */
+int setTickets(int pid, int tickets)
+{
+    checkMode("setTickets");
+    disableInterrupts();
+
+    procPtr process = findProc(pid);
+    if (process == NULL ||
+        process->priority == SENTINELPRIORITY || tickets < 1 || tickets > STRIDE1)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    process->tickets = tickets;
+    enableInterrupts();
+    return 0;
+}
+
+/*
+ * Sets how the stacks of processes forked from now on are committed:
+ * STACK_LAZY maps pages in as the process touches them, so idle processes
+ * cost little memory; STACK_PREFAULT makes the whole stack resident at
+ * fork1(), so the process takes no page faults on its stack once it runs.
+ * Return values:
+ * -1: if policy is neither STACK_LAZY nor STACK_PREFAULT.
+ *  otherwise: the previous policy.
+ */
+int setStackPolicy(int policy)
+{
+    checkMode("setStackPolicy");
+    disableInterrupts();
+
+    if (policy != STACK_LAZY && policy != STACK_PREFAULT)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    int old = StackPolicy;
+    StackPolicy = policy;
+    enableInterrupts();
+    return old;
+}
+
+/*
+ * Makes process pid a real-time process. Every period microseconds it is
+ * released with budget microseconds of CPU that must be used within deadline
+ * microseconds of the release. Until it quits, it runs ahead of every normal
+ * process whenever it has the earliest deadline of the released real-time
+ * processes. A period of 0 makes pid a normal process again.
+ * Return values:
+ * -1: if pid does not exist, runs at SENTINELPRIORITY, or the parameters do
+ *     not satisfy 0 < budget <= deadline <= period.
+ *  0: otherwise.
+ */
+int setDeadline(int pid, int period, int budget, int deadline)
+{
+    checkMode("setDeadline");
+    disableInterrupts();
+
+    procPtr process = findProc(pid);
+    if (process == NULL ||
+        process->priority == SENTINELPRIORITY || process->status == STATUS_QUIT)
+    {
+        enableInterrupts();
+        return -1;
+    }
+    if (period != 0 && (budget <= 0 || budget > deadline || deadline > period))
+    {
+        enableInterrupts();
+        return -1;
+    }
+    edfSetParams(process, period, budget, deadline);
+
+    // The running process may no longer be the one that should run
+    reschedIfNeeded(0);
+    enableInterrupts();
+    return 0;
+}
+
+/*
+ * Return the CPU time (in milliseconds) used by the current process, including
+ * its current time slice (which in tickless mode may be arbitrarily long).
  */
 int readtime(void)
 {
     checkMode("readtime");
-    return Current->CPUTime/1000;
+    disableInterrupts();
+    long CPUTime = Current->CPUTime + (readKernelTime() - Current->startTime);
+    enableInterrupts();
+    return CPUTime/1000;
 }
 
 /*
@@ -128,16 +491,23 @@ void dumpProcesses()
     checkMode("dumpProcesses");
     disableInterrupts();
 
-    USLOSS_Console("PID\tParent\tPriority\tStatus\t\t# Kids\tCPUtime\tName \n");
+    if (STACK_HIGH_WATER)
+    {
+        USLOSS_Console("PID\tParent\tPriority\tStatus\t\t# Kids\tCPUtime\tStack\tName \n");
+    }
+    else
+    {
+        USLOSS_Console("PID\tParent\tPriority\tStatus\t\t# Kids\tCPUtime\tName \n");
+    }
     int i;
-    for(i = 0; i < 50; i++)
+    for(i = 0; i < ProcTableSize; i++)
     {
-        procStruct process = ProcTable[i];
+        procStruct process = *slotToProc(i);
 
         // process is junk memory if the entry never existed
         if (process.pid == PID_NEVER_EXISTED || process.status == STATUS_DEAD)
         {
-            USLOSS_Console(" -1\t  -1\t   -1\t\tEMPTY\t\t  0\t   -1\n");
+            USLOSS_Console(" -1\t  -1\t   -1\t\tEMPTY\t\t  0\t   -1%s\n", STACK_HIGH_WATER ? "\t-1" : "");
             continue;
         }
 
@@ -145,7 +515,7 @@ void dumpProcesses()
         USLOSS_Console(" %d\t  ", process.pid);
 
         // Print the parent's pid
-        short parentPid;
+        int parentPid;
         if(process.parentPtr == NULL)
         {
             parentPid = NO_PARENT; 
@@ -188,6 +558,12 @@ void dumpProcesses()
                 case(STATUS_QUIT):
                     strcpy(status, "QUIT\t");
                     break;
+                case(STATUS_THROTTLED):
+                    strcpy(status, "THROTTLED");
+                    break;
+                case(STATUS_SLEEPING):
+                    strcpy(status, "SLEEPING");
+                    break;
                 default:
                     sprintf(status, "%d\t", process.status);
                     break;
@@ -204,7 +580,76 @@ void dumpProcesses()
         {
             CPUTime = -1;
         }
-        USLOSS_Console("%d\t%s\n", CPUTime, process.name);
+        if (STACK_HIGH_WATER)
+        {
+            // Processes still running report how deep their stack has gone so far
+            int stackUsed = process.stackHighWater;
+            if (process.status != STATUS_QUIT && process.lightweight)
+            {
+                stackUsed = sharedStackUse(slotToProc(i));
+            }
+            else if (process.status != STATUS_QUIT)
+            {
+                stackUsed = stackHighWater(process.stack, process.stackSize);
+            }
+            USLOSS_Console("%d\t%d\t%s\n", CPUTime, stackUsed, process.name);
+        }
+        else
+        {
+            USLOSS_Console("%d\t%s\n", CPUTime, process.name);
+        }
+    }
+    enableInterrupts();
+}
+
+/*
+ * Prints, for each process name, how much stack the processes by that name
+ * used before they quit. Needs a build with STACK_HIGH_WATER.
+ */
+void dumpStackUsage()
+{
+    checkMode("dumpStackUsage");
+    disableInterrupts();
+
+    if (!STACK_HIGH_WATER)
+    {
+        USLOSS_Console("dumpStackUsage(): Stack use is not measured. Build with -DSTACK_HIGH_WATER=1.\n");
+    }
+    else
+    {
+        printStackReport();
+    }
+    enableInterrupts();
+}
+
+/*
+ * This routine prints the scheduling counters kept by the kernel to the console.
+ */
+void dumpStats()
+{
+    checkMode("dumpStats");
+    disableInterrupts();
+
+    USLOSS_Console("Context switches:\t%ld\n", KernelStats.contextSwitches);
+    USLOSS_Console("Elided switches:\t%ld\n", KernelStats.elidedSwitches);
+    USLOSS_Console("Clock interrupts:\t%ld\n", KernelStats.clockInterrupts);
+    USLOSS_Console("Clock device reads:\t%ld\n", KernelStats.clockReads);
+    USLOSS_Console("Skipped ticks:\t\t%ld\n", KernelStats.skippedTicks);
+    USLOSS_Console("Avoided dispatches:\t%ld\n", KernelStats.avoidedDispatches);
+    USLOSS_Console("Callouts run:\t\t%ld\n", KernelStats.calloutsRun);
+    USLOSS_Console("Stacks reused:\t\t%ld\n", KernelStats.stacksReused);
+    USLOSS_Console("Shared stack copies:\t%ld\n", KernelStats.stackCopies);
+    USLOSS_Console("Shared stack bytes:\t%ld\n", KernelStats.stackBytesCopied);
+    USLOSS_Console("Aging boosts:\t\t%ld\n", KernelStats.agingBoosts);
+    USLOSS_Console("Max ready wait:\t\t%d\n", KernelStats.maxReadyWait);
+    long dispatches = KernelStats.contextSwitches + KernelStats.elidedSwitches;
+    if (dispatches > 0)
+    {
+        USLOSS_Console("Reads per dispatch:\t%.2f\n", (double) KernelStats.clockReads / dispatches);
+    }
+    if (KernelStats.clockInterrupts > 0)
+    {
+        USLOSS_Console("Reads per interrupt:\t%.2f\n", (double) KernelStats.clockReads / KernelStats.clockInterrupts);
     }
     enableInterrupts();
 }
@@ -236,10 +681,10 @@ int zap(int pid)
     {
         USLOSS_Console("zap(): Process %d now zapping process %d\n", Current->pid, pid);
     }
-    procPtr processBeingZapped = &ProcTable[pidToSlot(pid)];
+    procPtr processBeingZapped = findProc(pid);
 
     // check halting conditions
-    if(pid < 0 || !processExists(processBeingZapped) || pid != processBeingZapped->pid)
+    if(processBeingZapped == NULL)
     {
         USLOSS_Console("zap(): process being zapped does not exist.  Halting...\n");
         USLOSS_Halt(1);
@@ -271,8 +716,10 @@ int zap(int pid)
     // Add the current process to the list of processes that zapped the given process
     addZappedProcess(Current, processBeingZapped);
 
-    // Change the status of the process that is zapping
+    // Change the status of the process that is zapping, lending its priority to the target
     Current->status = STATUS_BLOCKED_ZAP;
+    Current->zapTargetPtr = processBeingZapped;
+    updateInheritedPriority(processBeingZapped);
 
     if (DEBUG && debugflag)
     {
@@ -281,6 +728,7 @@ int zap(int pid)
 
     // Wait for the target to quit
     dispatcher();
+    Current->zapTargetPtr = NULL;
 
     if(Current->isZapped)
     {
@@ -314,3 +762,17 @@ int isZapped(void)
         return 0;
     }
 }
+
+/*
+ * Callout that puts a process back on the Ready List when its sleep ends.
+ */
+static void wakeSleeper(void *arg)
+{
+    procPtr process = arg;
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("wakeSleeper(): Waking process %d.\n", process->pid);
+    }
+    process->status = STATUS_READY;
+    schedWakeup(process);
+}
@@ -9,62 +9,222 @@
    ------------------------------------------------------------------------ */
 
 #include "phase1utility.h"
+#include "sched.h"
+#include "stack.h"
+#include "sharedstack.h"
+#include <limits.h>
 
 extern unsigned int nextPid;
-extern procStruct ProcTable[];
+extern int ProcTableSize;
+extern int NumProcs;
 extern int debugflag;
-extern priorityQueue ReadyList;
 extern procPtr Current;
+extern int TimeSliceTable[];
+extern kernelStats KernelStats;
+extern int StackPolicy;
 
 void launch();
 
+// The time read from the clock on this entry into the kernel, if kernelTimeValid
+static int kernelTime;
+static bool kernelTimeValid = false;
+
+// Stands in for every chunk of the process table that is not allocated yet.
+// All of its handles are 0, which hashes to slot 0 in the first chunk.
+static procStruct EmptyChunk[PROC_CHUNK_SIZE];
+
+// The next pid that has never been given out, while it is at most MAX_PROCESSES
+static int FreshPid = SENTINELPID;
+
+// Bit i of DeadSlots is set iff slot i holds a dead process. Bit i of
+// DeadSummary is set iff word i of DeadSlots is non-zero.
+#define SLOT_WORD_BITS (8 * sizeof(unsigned long))
+#define SLOT_WORDS ((MAX_PROCESSES + SLOT_WORD_BITS - 1) / SLOT_WORD_BITS)
+#define SUMMARY_WORDS ((SLOT_WORDS + SLOT_WORD_BITS - 1) / SLOT_WORD_BITS)
+static unsigned long DeadSlots[SLOT_WORDS];
+static unsigned long DeadSummary[SUMMARY_WORDS];
+
+static int findDeadSlot(int);
+
 /*
- * Helper for fork1() that calculates the pid for the next process.
+ * Helper for fork1() that calculates the pid for the next process. Pids that
+ * were never used come first. After that a dead process's slot is reused,
+ * searching from the slot of nextPid, with that slot's next generation of pid.
  */
 int getNextPid()
 {
+    if (FreshPid <= MAX_PROCESSES)
+    {
+        return FreshPid;
+    }
     int baseSlot = pidToSlot(nextPid);
-    procPtr proc;
-    int slot;
+    int slot = findDeadSlot(baseSlot);
+    if (slot == -1 && baseSlot > 0)
+    {
+        slot = findDeadSlot(0);
+    }
+    if (slot == -1)
+    {
+        return -1; // no space left in the table
+    }
 
-    // Use linear probing to search for an unused open slot
-    for (int i = 0; i < MAXPROC; i++)
+    // return the next pid that will hash to the same spot.
+    int pid = slotToProc(slot)->pid;
+    if (pid > INT_MAX - MAX_PROCESSES)
+    {
+        // Start the slot's generations over rather than overflow
+        return slot == 0 ? MAX_PROCESSES : slot;
+    }
+    return pid + MAX_PROCESSES;
+}
+
+/*
+ * Records that fork1() gave pid, as returned by getNextPid(), to a process.
+ */
+void claimPid(int pid)
+{
+    slotToProc(pidToSlot(pid))->handle = pid;
+    if (FreshPid <= MAX_PROCESSES)
+    {
+        FreshPid++;
+    }
+    else
     {
-        slot = (baseSlot + i) % MAXPROC;
-        proc = &ProcTable[slot];
-        if (proc->pid == PID_NEVER_EXISTED)
+        int slot = pidToSlot(pid);
+        DeadSlots[slot / SLOT_WORD_BITS] &= ~(1UL << (slot % SLOT_WORD_BITS));
+        if (DeadSlots[slot / SLOT_WORD_BITS] == 0)
         {
-            // this slot was never occupied, so this pid is new
-            if (slot == 0)
-            {
-                return MAXPROC;
-            }
-            return slot;
+            int word = slot / SLOT_WORD_BITS;
+            DeadSummary[word / SLOT_WORD_BITS] &= ~(1UL << (word % SLOT_WORD_BITS));
         }
+    }
+}
 
+/*
+ * Returns the first slot at or after from that holds a dead process, or -1 if
+ * there is none.
+ */
+static int findDeadSlot(int from)
+{
+    int word = from / SLOT_WORD_BITS;
+    unsigned long bits = DeadSlots[word] & (~0UL << (from % SLOT_WORD_BITS));
+    if (bits != 0)
+    {
+        return word * SLOT_WORD_BITS + __builtin_ctzl(bits);
     }
 
-    // Search for dead processes to remove
-    for (int i = 0; i < MAXPROC; i++)
+    // Find the next word with a dead slot in it through the summary
+    word++;
+    if (word >= SLOT_WORDS)
     {
-        slot = (baseSlot + i) % MAXPROC;
-        proc = &ProcTable[slot];
-        if (proc->status == STATUS_DEAD)
+        return -1;
+    }
+    int summaryWord = word / SLOT_WORD_BITS;
+    bits = DeadSummary[summaryWord] & (~0UL << (word % SLOT_WORD_BITS));
+    while (bits == 0)
+    {
+        summaryWord++;
+        if (summaryWord >= SUMMARY_WORDS)
         {
-            // return the next pid that will hash to the same spot.
-            return proc->pid + MAXPROC;
+            return -1;
         }
+        bits = DeadSummary[summaryWord];
     }
-
-    return -1; // no space left in the table
+    word = summaryWord * SLOT_WORD_BITS + __builtin_ctzl(bits);
+    return word * SLOT_WORD_BITS + __builtin_ctzl(DeadSlots[word]);
 }
 
 /*
- * Helper for fork1() that hashes a pid into a table index.
+ * Helper for fork1() that hashes a pid into a table index. The divisor is a
+ * constant, so this compiles to a multiply, or to a mask if MAX_PROCESSES is a
+ * power of two.
  */
 int pidToSlot(int pid)
 {
-    return pid % MAXPROC;
+    return (unsigned int) pid % MAX_PROCESSES;
+}
+
+/*
+ * Returns the process table entry in slot, which must be less than
+ * ProcTableSize.
+ */
+procPtr slotToProc(int slot)
+{
+    return &ProcTable[slot >> PROC_CHUNK_BITS][slot & PROC_CHUNK_MASK];
+}
+
+/*
+ * Sets up an empty process table with its first chunk allocated.
+ */
+void initProcTable()
+{
+    for (int chunk = 0; chunk < PROC_CHUNKS; chunk++)
+    {
+        ProcTable[chunk] = EmptyChunk;
+    }
+    ProcTableSize = 0;
+    if (!growProcTable(SENTINELPID))
+    {
+        USLOSS_Console("startup(): Could not allocate the process table. Halting...\n");
+        USLOSS_Halt(1);
+    }
+}
+
+/*
+ * Allocates chunks of the process table until it holds slot. Chunks are
+ * allocated in order, so every slot below ProcTableSize is usable. Returns
+ * false iff memory ran out.
+ */
+bool growProcTable(int slot)
+{
+    while (slot >= ProcTableSize)
+    {
+        procPtr chunk = malloc(PROC_CHUNK_SIZE * sizeof(procStruct));
+        if (chunk == NULL)
+        {
+            return false;
+        }
+        for (int i = 0; i < PROC_CHUNK_SIZE; i++)
+        {
+            chunk[i].pid = PID_NEVER_EXISTED;
+            chunk[i].handle = NO_HANDLE(ProcTableSize + i);
+            chunk[i].priority = -1;
+            chunk[i].status = STATUS_EMPTY;
+        }
+        ProcTable[ProcTableSize >> PROC_CHUNK_BITS] = chunk;
+        ProcTableSize += PROC_CHUNK_SIZE;
+        if (ProcTableSize > MAX_PROCESSES)
+        {
+            ProcTableSize = MAX_PROCESSES;
+        }
+    }
+    return true;
+}
+
+/*
+ * Marks proc, which has quit, as dead. Its process table entry may then be
+ * reused, and its stack goes back to the pool.
+ */
+void markDead(procPtr proc)
+{
+    if (proc->status != STATUS_DEAD)
+    {
+        proc->status = STATUS_DEAD;
+        NumProcs--;
+        int slot = pidToSlot(proc->pid);
+        proc->handle = NO_HANDLE(slot);
+        if (proc->lightweight)
+        {
+            releaseSharedStack(proc);
+        }
+        else
+        {
+            freeStack(proc->stack, proc->stackSize);
+            proc->stack = NULL;
+        }
+        DeadSlots[slot / SLOT_WORD_BITS] |= 1UL << (slot % SLOT_WORD_BITS);
+        DeadSummary[slot / SLOT_WORD_BITS / SLOT_WORD_BITS] |= 1UL << (slot / SLOT_WORD_BITS % SLOT_WORD_BITS);
+    }
 }
 
 /*
@@ -91,16 +251,26 @@ bool inKernelMode()
  * Returns -1 iff one of the parameters is invalid in such a way that fork1()
  * should return -1. Returns 0 otherwise.
  */
-int initProc(procPtr parentPtr, procPtr proc, char *name, int (*startFunc)(char *), char *arg, int stacksize, int priority, int pid)
+int initProc(procPtr parentPtr, procPtr proc, char *name, int (*startFunc)(char *), char *arg, int stacksize, int priority, int pid, int lightweight)
 {
     // fill out list pointers
     proc->nextProcPtr = NULL;
+    proc->prevProcPtr = NULL;
+    proc->onQueue = NULL;
+    proc->onHeap = NULL;
     proc->childProcPtr = NULL;
+    proc->lastChildPtr = NULL;
     proc->nextSiblingPtr = NULL;
+    proc->prevSiblingPtr = NULL;
+    proc->numKids = 0;
     proc->quitChildPtr = NULL;
+    proc->lastQuitChildPtr = NULL;
     proc->nextQuitSiblingPtr = NULL;
     proc->procThatZappedMe = NULL;
     proc->nextSiblingThatZapped = NULL;
+    proc->zapTargetPtr = NULL;
+    proc->nextBlockedPtr = NULL;
+    proc->prevBlockedPtr = NULL;
 
     // fill out parent pointer
     proc->parentPtr = parentPtr;
@@ -136,19 +306,6 @@ int initProc(procPtr parentPtr, procPtr proc, char *name, int (*startFunc)(char
         strcpy(proc->startArg, arg);
     }
 
-    // create the stack
-    proc->stack = malloc(sizeof(char) * stacksize);
-    if (proc->stack == NULL)
-    {
-        USLOSS_Console("fork1(): Cannot allocate stack for process.  Halting...\n");
-        USLOSS_Halt(1);
-    }
-    proc->stackSize = stacksize;
-
-    // Initialize context for this process, but use launch function pointer for
-    // the initial value of the process's program counter (PC)
-    USLOSS_ContextInit(&(proc->state), proc->stack, proc->stackSize, NULL, launch);
-
     // fill out priority
     if (priority < 1 || priority > SENTINELPRIORITY)
     {
@@ -159,6 +316,14 @@ int initProc(procPtr parentPtr, procPtr proc, char *name, int (*startFunc)(char
         return -1;
     }
     proc->priority = priority;
+    proc->basePriority = priority;
+    proc->boostedFrom = 0;
+    proc->agedFrom = 0;
+    proc->tickets = DEFAULT_TICKETS(priority);
+    proc->pass = 0;
+    proc->vruntime = 0;
+    proc->burstTime = 0;
+    proc->burstEstimate = BURST_INITIAL_ESTIMATE;
 
     // fill out startFunc
     if (startFunc == NULL)
@@ -171,10 +336,44 @@ int initProc(procPtr parentPtr, procPtr proc, char *name, int (*startFunc)(char
     }
     proc->startFunc = startFunc;
 
+    // create the stack, once nothing else can fail
+    proc->stackHighWater = 0;
+    proc->lightweight = lightweight;
+    if (lightweight)
+    {
+        // The switcher initializes the context when the proc first runs
+        initSharedStack();
+        proc->stack = NULL;
+        proc->stackSize = SHARED_STACK_SIZE;
+        proc->sharedStackLow = NULL;
+        proc->savedStack = NULL;
+        proc->savedStackCapacity = 0;
+        proc->sharedStackDepth = 0;
+    }
+    else
+    {
+        proc->stackSize = stackAllocSize(stacksize);
+        proc->stack = allocStack(stacksize, StackPolicy);
+        if (proc->stack == NULL)
+        {
+            USLOSS_Console("fork1(): Cannot allocate stack for process.  Halting...\n");
+            USLOSS_Halt(1);
+        }
+
+        // Initialize context for this process, but use launch function pointer for
+        // the initial value of the process's program counter (PC)
+        USLOSS_ContextInit(&(proc->state), proc->stack, proc->stackSize, NULL, launch);
+    }
+
     // fill out the rest of the fields
     proc->pid = pid;
     proc->status = STATUS_READY;
     proc->CPUTime = 0;
+    proc->timeSliceOverride = 0;
+    proc->donatedSlice = 0;
+    proc->sleepCallout.slot = NULL;
+    proc->rtPeriod = 0;
+    proc->nextRTProcPtr = NULL;
     proc->isZapped = 0;
 
     return 0;
@@ -198,14 +397,7 @@ void checkMode(char * funcName)
  */
 int numChildren(procPtr process)
 {
-    int numChildren = 0;
-    procPtr currentChildPtr = process->childProcPtr;
-    while(currentChildPtr != NULL)
-    {
-        numChildren++;
-        currentChildPtr = currentChildPtr->nextSiblingPtr;
-    }
-    return numChildren;
+    return process->numKids;
 }
 
 /*
@@ -242,6 +434,9 @@ void enableInterrupts()
     // get the current value of the psr
     unsigned int psr = USLOSS_PsrGet();
 
+    // time passes once we leave the critical section, so forget the cached time
+    kernelTimeValid = false;
+
     // set the current interrupt bit to 1
     psr = psr | USLOSS_PSR_CURRENT_INT;
 
@@ -268,14 +463,12 @@ void addChild(procPtr child, procPtr parent)
         }
         else
         {
-            // Current has children, look for youngest older sibling
-            procPtr olderSib = parent->childProcPtr;
-            while (olderSib->nextSiblingPtr != NULL)
-            {
-                olderSib = olderSib->nextSiblingPtr;
-            }
-            olderSib->nextSiblingPtr = child;
+            // Current has children, so the youngest becomes the older sibling
+            parent->lastChildPtr->nextSiblingPtr = child;
+            child->prevSiblingPtr = parent->lastChildPtr;
         }
+        parent->lastChildPtr = child;
+        parent->numKids++;
     }
 }
 
@@ -290,41 +483,36 @@ void addQuitChild(procPtr parent, procPtr child)
     }
     else
     {
-        procPtr quitChildPtr = parent->quitChildPtr;
-        // add Current to nextQuitSiblingPtr list
-        while(quitChildPtr->nextQuitSiblingPtr != NULL)
-        {
-            quitChildPtr = quitChildPtr->nextQuitSiblingPtr;
-        }
-        quitChildPtr->nextQuitSiblingPtr = child;
+        // add Current to the end of the nextQuitSiblingPtr list
+        parent->lastQuitChildPtr->nextQuitSiblingPtr = child;
     }
+    parent->lastQuitChildPtr = child;
 }
 
 /*
- * Helper used by join to remove children from the child list.
+ * Helper used by join to remove a joined child from its parent's child list.
  */
-void removeDeadChildren(procPtr parent)
+void removeChild(procPtr parent, procPtr child)
 {
-    if (parent == NULL)
+    if (child->prevSiblingPtr != NULL)
     {
-        return;
+        child->prevSiblingPtr->nextSiblingPtr = child->nextSiblingPtr;
     }
-
-    // Handle leading dead children
-    while (parent->childProcPtr != NULL && parent->childProcPtr->status == STATUS_DEAD)
+    else
     {
-        parent->childProcPtr = parent->childProcPtr->nextSiblingPtr;
+        parent->childProcPtr = child->nextSiblingPtr;
     }
-
-    procPtr olderSibling = parent->childProcPtr; // Older sibling is not dead
-    while(olderSibling != NULL && olderSibling->nextSiblingPtr != NULL)
+    if (child->nextSiblingPtr != NULL)
     {
-        if (olderSibling->nextSiblingPtr->status == STATUS_DEAD)
-        {
-            olderSibling->nextSiblingPtr = olderSibling->nextSiblingPtr->nextSiblingPtr;
-        }
-        olderSibling = olderSibling->nextSiblingPtr;
+        child->nextSiblingPtr->prevSiblingPtr = child->prevSiblingPtr;
+    }
+    else
+    {
+        parent->lastChildPtr = child->prevSiblingPtr;
     }
+    child->nextSiblingPtr = NULL;
+    child->prevSiblingPtr = NULL;
+    parent->numKids--;
 }
 
 /*
@@ -358,7 +546,7 @@ void unblockProcessesThatZappedThisProcess(procPtr process)
       while(procThatZappedMe != NULL)
       {
           procThatZappedMe->status = STATUS_READY;
-          addProc(&ReadyList, procThatZappedMe);
+          schedWakeup(procThatZappedMe);
           procThatZappedMe = procThatZappedMe->nextSiblingThatZapped;
       }
       // Remove the pointer to nextSiblingThatZapped for each
@@ -376,12 +564,94 @@ void unblockProcessesThatZappedThisProcess(procPtr process)
   }
 }
 
+/*
+ * Recomputes the priority of process under priority inheritance: the best of
+ * its own priority and the priorities of the processes blocked zapping it or
+ * blocked in join() waiting for it. If that changes its priority, the change
+ * is passed on to whatever process is itself blocked on.
+ */
+void updateInheritedPriority(procPtr process)
+{
+    if (!PRIORITY_INHERITANCE)
+    {
+        return;
+    }
+
+    int ownPriority = process->boostedFrom != 0 ? process->boostedFrom : process->priority;
+    int best = ownPriority;
+    for (procPtr zapper = process->procThatZappedMe; zapper != NULL; zapper = zapper->nextSiblingThatZapped)
+    {
+        if (zapper->status == STATUS_BLOCKED_ZAP && zapper->priority < best)
+        {
+            best = zapper->priority;
+        }
+    }
+    procPtr parent = process->parentPtr;
+    if (parent != NULL && parent->status == STATUS_BLOCKED_JOIN && parent->priority < best)
+    {
+        best = parent->priority;
+    }
+
+    process->boostedFrom = best < ownPriority ? ownPriority : 0;
+    if (best == process->priority)
+    {
+        return;
+    }
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("updateInheritedPriority(): Process %d now runs at priority %d.\n", process->pid, best);
+    }
+
+    // Move the process to its new level if it is waiting to run
+    if (process->status == STATUS_READY && process != Current)
+    {
+        schedDequeue(process);
+        process->priority = best;
+        schedRequeue(process);
+    }
+    else
+    {
+        process->priority = best;
+    }
+
+    // Pass the change on down the chain of waiting
+    if (process->status == STATUS_BLOCKED_ZAP && process->zapTargetPtr != NULL)
+    {
+        updateInheritedPriority(process->zapTargetPtr);
+    }
+    else if (process->status == STATUS_BLOCKED_JOIN)
+    {
+        updateChildrenInheritedPriority(process);
+    }
+}
+
+/*
+ * Recomputes the inherited priority of every child of parent that has not
+ * quit yet. Called when parent starts or stops waiting in join().
+ */
+void updateChildrenInheritedPriority(procPtr parent)
+{
+    if (!PRIORITY_INHERITANCE)
+    {
+        return;
+    }
+
+    for (procPtr child = parent->childProcPtr; child != NULL; child = child->nextSiblingPtr)
+    {
+        if (child->status != STATUS_QUIT && child->status != STATUS_DEAD)
+        {
+            updateInheritedPriority(child);
+        }
+    }
+}
+
 /*
  * Gets the current time in microseconds from USLOSS.
  */
 int getCurrentTime()
 {
     int time;
+    KernelStats.clockReads++;
     int result = USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &time);
     if (result == USLOSS_DEV_INVALID)
     {
@@ -391,6 +661,48 @@ int getCurrentTime()
     return time;
 }
 
+/*
+ * Returns the current time in microseconds. The clock device is read at most
+ * once per entry into the kernel: later calls made before interrupts are
+ * enabled again return the same timestamp.
+ */
+int readKernelTime()
+{
+    if (!kernelTimeValid)
+    {
+        kernelTime = getCurrentTime();
+        kernelTimeValid = true;
+    }
+    return kernelTime;
+}
+
+/*
+ * Discards the timestamp cached by readKernelTime(). Interrupt handlers call
+ * this on entry, since they return to the interrupted code without going
+ * through enableInterrupts().
+ */
+void forgetKernelTime()
+{
+    kernelTimeValid = false;
+}
+
+/*
+ * Returns the quantum (microseconds) that proc may run before timeSlice()
+ * preempts it: its own override if it has one, otherwise its priority's.
+ */
+int getTimeSlice(procPtr proc)
+{
+    if (proc->donatedSlice > 0)
+    {
+        return proc->donatedSlice;
+    }
+    if (proc->timeSliceOverride > 0)
+    {
+        return proc->timeSliceOverride;
+    }
+    return TimeSliceTable[proc->priority - 1];
+}
+
 /*
  * Prints the child list of the given parent. Used for debugging exclusively
  */
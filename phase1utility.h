@@ -15,22 +15,47 @@
 #include <queue.h>
 
 int getNextPid();
+void claimPid(int);
 int pidToSlot(int);
+procPtr slotToProc(int);
+void initProcTable();
+bool growProcTable(int);
+void markDead(procPtr);
 bool processExists(procPtr);
 bool inKernelMode();
-int initProc(procPtr, procPtr, char *, int(*startFunc)(char *), char *, int, int, int);
+int initProc(procPtr, procPtr, char *, int(*startFunc)(char *), char *, int, int, int, int);
 void checkMode(char *);
 int numChildren(procPtr);
 void enableInterrupts();
 void disableInterrupts();
 void addChild(procPtr, procPtr);
 void addQuitChild(procPtr, procPtr);
-void removeDeadChildren(procPtr);
+void removeChild(procPtr, procPtr);
 void addZappedProcess(procPtr, procPtr);
 void unblockProcessesThatZappedThisProcess(procPtr);
+void updateInheritedPriority(procPtr);
+void updateChildrenInheritedPriority(procPtr);
 int getCurrentTime();
+int readKernelTime();
+void forgetKernelTime();
+int getTimeSlice(procPtr);
 
 // Functions used only for debugging
 void printChildList(procPtr);
 
+extern procPtr ProcTable[];
+
+/*
+ * Returns the process with the given pid, or NULL if it does not exist (it
+ * never did, or it has been joined). A single comparison against the entry
+ * the pid hashes to decides, since entries without a process carry a handle
+ * that hashes elsewhere.
+ */
+static inline procPtr findProc(int pid)
+{
+    unsigned int slot = (unsigned int) pid % MAX_PROCESSES;
+    procPtr proc = &ProcTable[slot >> PROC_CHUNK_BITS][slot & PROC_CHUNK_MASK];
+    return proc->handle == pid ? proc : NULL;
+}
+
 #endif
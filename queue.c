@@ -3,6 +3,13 @@
    Defines functions that manipulate a priority queue struct that allows us
    to store processes and access the highest priority process in the queue.
 
+   Each FIFO is an intrusive doubly-linked list threaded through the
+   nextProcPtr/prevProcPtr fields of procStruct. Every process records the
+   queue (and level) it is on, so membership tests, enqueue, dequeue and
+   removal from the middle of a queue are all constant time. A bitmap of the
+   non-empty levels lets removeProc() find the highest ready level with a
+   find-first-set instead of scanning every level.
+
    University of Arizona
    Computer Science 452
    Fall 2015
@@ -15,7 +22,10 @@
 static bool isEmpty(queuePtr);
 static void addProcFIFO(queuePtr, procPtr);
 static procPtr removeProcFIFO(queuePtr);
-static int containsPID(pqPtr, int);
+static void unlinkProcFIFO(queuePtr, procPtr);
+static void setLevelBit(pqPtr, int);
+static void clearLevelBit(pqPtr, int);
+static int firstNonEmptyLevel(pqPtr);
 extern int debugflag;
 
 
@@ -31,47 +41,58 @@ void initPriorityQueue(pqPtr pq)
         pq->queues[i].head = NULL;
         pq->queues[i].tail = NULL;
     }
+    for (int i = 0; i < BITMAP_WORDS; i++)
+    {
+        pq->nonEmpty[i] = 0;
+    }
 }
 
 /*
  * Adds the process proc to the back of the priority queue pq. pq must be non-
- * NULL. proc is assumed to have a NULL nextProcPtr.
+ * NULL. Does nothing if proc is already on pq.
  */
 void addProc(pqPtr pq, procPtr proc)
 {
-    if(containsPID(pq, proc->pid))
+    if (containsProc(pq, proc))
     {
-        if(DEBUG && debugflag)
+        if (DEBUG && debugflag)
         {
             USLOSS_Console("addProc(): Not adding %d to wait list because it exists already", proc->pid);
         }
         return;
     }
-    queuePtr q = &(pq->queues[proc->priority - 1]);
-    addProcFIFO(q, proc);
+    int level = proc->priority - 1;
+    addProcFIFO(&(pq->queues[level]), proc);
+    setLevelBit(pq, level);
+    proc->onQueue = pq;
+    proc->queueLevel = level;
 }
 
 /*
- * Determines if the given priority queue contains the given pid. If yes, return 1. If not, return 0
+ * Returns 1 if proc is currently on the priority queue pq, 0 otherwise.
  */
-int containsPID(pqPtr pq, int pid)
+int containsProc(pqPtr pq, procPtr proc)
 {
-    if(pq == NULL)
+    return pq != NULL && proc->onQueue == pq;
+}
+
+/*
+ * Removes the process proc from wherever it is in pq, regardless of its
+ * position or priority. Does nothing if proc is not on pq.
+ */
+void unlinkProc(pqPtr pq, procPtr proc)
+{
+    if (!containsProc(pq, proc))
     {
-        return 0;
+        return;
     }
-    for (int i = 0; i < SENTINELPRIORITY; i++)
+    queuePtr q = &(pq->queues[proc->queueLevel]);
+    unlinkProcFIFO(q, proc);
+    if (isEmpty(q))
     {
-        queue singleQueue = pq->queues[i];
-        procPtr node = singleQueue.head;
-        while(node != NULL)
-        {
-            if(node->pid == pid)
-                return 1;
-            node = node->nextProcPtr;
-        }
+        clearLevelBit(pq, proc->queueLevel);
     }
-    return 0;
+    proc->onQueue = NULL;
 }
 
 /*
@@ -82,17 +103,29 @@ int containsPID(pqPtr pq, int pid)
  */
 procPtr removeProc(pqPtr pq)
 {
-    queuePtr q = NULL;
-
-    for (int i = 0; i < SENTINELPRIORITY; i++)
+    int level = firstNonEmptyLevel(pq);
+    if (level == -1)
     {
-        q = &(pq->queues[i]);
-        if (!isEmpty(q))
-        {
-            break;
-        }
+        return NULL;
+    }
+    queuePtr q = &(pq->queues[level]);
+    procPtr ret = removeProcFIFO(q);
+    if (isEmpty(q))
+    {
+        clearLevelBit(pq, level);
     }
-    return removeProcFIFO(q);
+    ret->onQueue = NULL;
+    return ret;
+}
+
+/*
+ * Returns the priority of the highest priority process in pq, or -1 if pq is
+ * empty.
+ */
+int highestReadyPriority(pqPtr pq)
+{
+    int level = firstNonEmptyLevel(pq);
+    return level == -1 ? -1 : level + 1;
 }
 
 void printPriorityQueue(pqPtr pq)
@@ -127,20 +160,21 @@ static bool isEmpty(queuePtr q)
 
 /*
  * Adds the process proc to the back of thie FIFO queue q. q must be non-NULL.
- * proc is assumed to have a NULL nextProcPtr and cannot be NULL.
+ * proc cannot be NULL and must not already be on a queue.
  */
 static void addProcFIFO(queuePtr q, procPtr proc)
 {
+    proc->nextProcPtr = NULL;
+    proc->prevProcPtr = q->tail;
     if (isEmpty(q))
     {
         q->head = proc;
-        q->tail = proc;
     }
     else
     {
         q->tail->nextProcPtr = proc;
-        q->tail = proc;
     }
+    q->tail = proc;
 }
 
 /*
@@ -154,7 +188,64 @@ static procPtr removeProcFIFO(queuePtr q)
         return NULL;
     }
     procPtr ret = q->head;
-    q->head = ret->nextProcPtr;
-    ret->nextProcPtr = NULL;
+    unlinkProcFIFO(q, ret);
     return ret;
 }
+
+/*
+ * Unlinks proc from the FIFO queue q, fixing up the neighbouring links and
+ * the head/tail pointers. proc must be on q.
+ */
+static void unlinkProcFIFO(queuePtr q, procPtr proc)
+{
+    if (proc->prevProcPtr == NULL)
+    {
+        q->head = proc->nextProcPtr;
+    }
+    else
+    {
+        proc->prevProcPtr->nextProcPtr = proc->nextProcPtr;
+    }
+    if (proc->nextProcPtr == NULL)
+    {
+        q->tail = proc->prevProcPtr;
+    }
+    else
+    {
+        proc->nextProcPtr->prevProcPtr = proc->prevProcPtr;
+    }
+    proc->nextProcPtr = NULL;
+    proc->prevProcPtr = NULL;
+}
+
+/*
+ * Marks level as non-empty in the bitmap of pq.
+ */
+static void setLevelBit(pqPtr pq, int level)
+{
+    pq->nonEmpty[level / BITMAP_WORD_BITS] |= 1UL << (level % BITMAP_WORD_BITS);
+}
+
+/*
+ * Marks level as empty in the bitmap of pq.
+ */
+static void clearLevelBit(pqPtr pq, int level)
+{
+    pq->nonEmpty[level / BITMAP_WORD_BITS] &= ~(1UL << (level % BITMAP_WORD_BITS));
+}
+
+/*
+ * Returns the index of the highest priority non-empty level of pq, or -1 if
+ * every level is empty.
+ */
+static int firstNonEmptyLevel(pqPtr pq)
+{
+    for (int i = 0; i < BITMAP_WORDS; i++)
+    {
+        if (pq->nonEmpty[i] != 0)
+        {
+            return i * BITMAP_WORD_BITS + __builtin_ctzl(pq->nonEmpty[i]);
+        }
+    }
+    return -1;
+}
@@ -17,6 +17,10 @@ typedef struct queue * queuePtr;
 typedef struct priorityQueue priorityQueue;
 typedef struct priorityQueue * pqPtr;
 
+// Size of the bitmap of non-empty levels kept by each priority queue
+#define BITMAP_WORD_BITS (8 * sizeof(unsigned long))
+#define BITMAP_WORDS ((SENTINELPRIORITY + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS)
+
 struct queue
 {
     procPtr head;
@@ -26,11 +30,15 @@ struct queue
 struct priorityQueue
 {
      queue queues[SENTINELPRIORITY];
+     unsigned long nonEmpty[BITMAP_WORDS];   // Bit i is set iff queues[i] is non-empty
 };
 
 void initPriorityQueue(pqPtr);
 void addProc(pqPtr, procPtr);
 procPtr removeProc(pqPtr);
+void unlinkProc(pqPtr, procPtr);
+int containsProc(pqPtr, procPtr);
+int highestReadyPriority(pqPtr);
 void printPriorityQueue(pqPtr);
 
 #endif /* _QUEUE_H */
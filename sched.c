@@ -0,0 +1,420 @@
+/* ------------------------------------------------------------------------
+   sched.c
+   Scheduler policy selection and the default policy. Every policy is a
+   schedOps table; startup() picks one with initScheduler() and the kernel
+   only ever reaches the run queue through the sched*() functions here, which
+   give real-time processes to the EDF class ahead of the Sched policy.
+
+   The default policy is strict priority with round robin within a priority:
+   the highest priority ready process always runs, and timeSlice() preempts
+   it once it has used up its quantum. If AGING_THRESHOLD is set, a process
+   that has waited that long on the ready list is raised one priority, again
+   for every further AGING_THRESHOLD it waits, and returns to its own priority
+   once it runs.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+
+   ------------------------------------------------------------------------ */
+
+#include "sched.h"
+#include "queue.h"
+#include "phase1utility.h"
+
+extern priorityQueue ReadyList;
+extern procPtr Current;
+extern kernelStats KernelStats;
+extern int debugflag;
+
+static void priorityRRInit(void);
+static void priorityRREnqueue(procPtr);
+static void priorityRRDequeue(procPtr);
+static procPtr priorityRRPickNext(void);
+static int priorityRRTick(procPtr, int);
+static int priorityRRContended(procPtr);
+static int priorityRRPreempts(procPtr, procPtr);
+static void priorityRRPicked(procPtr);
+static void ageReadyList(int);
+static void checkPreempts(procPtr);
+
+// The policy in use
+schedOps *Sched = &PriorityRROps;
+
+// Set when a process became runnable that should run before Current. The
+// switch happens at the next safe point: the end of the kernel call or the
+// next clock interrupt.
+int NeedResched = 0;
+
+// The process yieldTo() handed the CPU to, or NULL. It is taken off the ready
+// list by the next schedPickNext() unless a real-time process is runnable.
+procPtr YieldTarget = NULL;
+
+// All known policies, indexed by their SCHED_* constant
+static schedOps *SchedPolicies[NUM_SCHED_POLICIES] =
+{
+    &PriorityRROps,
+    &MLFQOps,
+    &StrideOps,
+    &CFSOps,
+    &SRTFOps,
+};
+
+schedOps PriorityRROps =
+{
+    "priority-rr",
+    priorityRRInit,
+    priorityRREnqueue,
+    priorityRRDequeue,
+    priorityRRPickNext,
+    priorityRRTick,
+    priorityRREnqueue,
+    noCharge,
+    priorityRRContended,
+    priorityRRPreempts,
+    priorityRRPicked,
+};
+
+/*
+ * Selects the scheduler policy with the given SCHED_* number and initializes
+ * it. Halts if there is no such policy.
+ */
+void initScheduler(int policy)
+{
+    if (policy < 0 || policy >= NUM_SCHED_POLICIES)
+    {
+        USLOSS_Console("initScheduler(): Unknown scheduler policy %d.  Halting...\n", policy);
+        USLOSS_Halt(1);
+    }
+    Sched = SchedPolicies[policy];
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("initScheduler(): Using the %s scheduler.\n", Sched->name);
+    }
+    Sched->init();
+    RealTimeOps.init();
+}
+
+/*
+ * Makes the ready process proc runnable (after fork1() or preemption).
+ */
+void schedEnqueue(procPtr proc)
+{
+    proc->readySince = readKernelTime();
+    proc->lastAged = proc->readySince;
+    schedRequeue(proc);
+}
+
+/*
+ * Puts back a process that schedDequeue() took off its run queue to change
+ * its priority or class. Its wait so far still counts, for aging and for
+ * maxReadyWait.
+ */
+void schedRequeue(procPtr proc)
+{
+    if (IS_REAL_TIME(proc))
+    {
+        RealTimeOps.enqueue(proc);
+    }
+    else
+    {
+        Sched->enqueue(proc);
+    }
+    checkPreempts(proc);
+}
+
+/*
+ * Removes proc from whichever run queue it is on.
+ */
+void schedDequeue(procPtr proc)
+{
+    if (IS_REAL_TIME(proc))
+    {
+        RealTimeOps.dequeue(proc);
+    }
+    else
+    {
+        Sched->dequeue(proc);
+    }
+}
+
+/*
+ * Removes and returns the next process to run. Runnable real-time processes
+ * always come first, then the target of a directed yield.
+ */
+procPtr schedPickNext(void)
+{
+    procPtr next = RealTimeOps.pickNext();
+    if (next == NULL && YieldTarget != NULL && YieldTarget->status == STATUS_READY)
+    {
+        next = YieldTarget;
+        schedDequeue(next);
+        Sched->picked(next);
+    }
+    else if (next == NULL)
+    {
+        next = Sched->pickNext();
+    }
+    if (YieldTarget != NULL && YieldTarget != next)
+    {
+        YieldTarget->donatedSlice = 0;
+    }
+    YieldTarget = NULL;
+    // The sentinel is ready whenever anything else runs, so its wait only
+    // says how long the CPU was busy
+    if (next != NULL && next->priority != SENTINELPRIORITY)
+    {
+        int wait = readKernelTime() - next->readySince;
+        if (wait > KernelStats.maxReadyWait)
+        {
+            KernelStats.maxReadyWait = wait;
+        }
+    }
+    return next;
+}
+
+/*
+ * Clock tick for the running process proc. Returns 1 iff proc should be
+ * preempted.
+ */
+int schedTick(procPtr proc, int currentTime)
+{
+    int preempt = RealTimeOps.tick(proc, currentTime);
+    if (IS_REAL_TIME(proc))
+    {
+        return preempt;
+    }
+    return Sched->tick(proc, currentTime) || preempt;
+}
+
+/*
+ * Makes proc, which was blocked, runnable again.
+ */
+void schedWakeup(procPtr proc)
+{
+    proc->readySince = readKernelTime();
+    proc->lastAged = proc->readySince;
+    if (IS_REAL_TIME(proc))
+    {
+        RealTimeOps.wakeup(proc);
+    }
+    else
+    {
+        Sched->wakeup(proc);
+    }
+    checkPreempts(proc);
+}
+
+/*
+ * Accounts deltaTime microseconds of CPU just used by proc.
+ */
+void schedCharge(procPtr proc, int deltaTime)
+{
+    if (IS_REAL_TIME(proc))
+    {
+        RealTimeOps.charge(proc, deltaTime);
+    }
+    else
+    {
+        Sched->charge(proc, deltaTime);
+    }
+}
+
+/*
+ * Returns 1 iff the clock interrupt has work to do while proc is running:
+ * some runnable process could preempt it, or a policy needs the clock.
+ */
+int schedNeedsTick(procPtr proc)
+{
+    return NeedResched || RealTimeOps.contended(proc) || Sched->contended(proc);
+}
+
+/*
+ * Calls the dispatcher iff a process that should run before Current has
+ * become runnable since the last dispatch. Kernel calls that make processes
+ * runnable call this on their way out instead of calling the dispatcher,
+ * passing the number of processes they made runnable.
+ */
+void reschedIfNeeded(int woken)
+{
+    if (NeedResched)
+    {
+        dispatcher();
+    }
+    else if (woken > 0)
+    {
+        KernelStats.avoidedDispatches++;
+    }
+}
+
+/*
+ * Sets NeedResched if proc, which just became runnable, should run before
+ * Current. Real-time processes beat normal ones, and the earlier deadline wins
+ * between real-time processes; otherwise the policy decides.
+ */
+static void checkPreempts(procPtr proc)
+{
+    if (proc == Current)
+    {
+        return;
+    }
+    int preempts;
+    if (Current == NULL)
+    {
+        preempts = 1;
+    }
+    else if (IS_REAL_TIME(proc))
+    {
+        preempts = !IS_REAL_TIME(Current) || proc->rtAbsDeadline < Current->rtAbsDeadline;
+    }
+    else if (IS_REAL_TIME(Current))
+    {
+        preempts = 0;
+    }
+    else
+    {
+        preempts = Sched->preempts(proc, Current);
+    }
+    if (preempts)
+    {
+        NeedResched = 1;
+    }
+}
+
+/*
+ * Forgets any scheduling state kept for proc, which is quitting.
+ */
+void schedQuit(procPtr proc)
+{
+    if (IS_REAL_TIME(proc))
+    {
+        edfRemove(proc);
+    }
+}
+
+/*
+ * charge hook for policies that do not need to know how long a process ran.
+ */
+void noCharge(procPtr proc, int deltaTime)
+{
+}
+
+/*
+ * picked hook for policies with nothing to update when a process is chosen.
+ */
+void noPicked(procPtr proc)
+{
+}
+
+static void priorityRRInit(void)
+{
+    initPriorityQueue(&ReadyList);
+}
+
+static void priorityRREnqueue(procPtr proc)
+{
+    addProc(&ReadyList, proc);
+}
+
+static void priorityRRDequeue(procPtr proc)
+{
+    unlinkProc(&ReadyList, proc);
+}
+
+/*
+ * Removes the highest priority ready process, dropping any priority it gained
+ * by aging.
+ */
+static procPtr priorityRRPickNext(void)
+{
+    procPtr next = removeProc(&ReadyList);
+    if (next != NULL)
+    {
+        priorityRRPicked(next);
+    }
+    return next;
+}
+
+/*
+ * A process that aging raised goes back to its own priority once it runs.
+ */
+static void priorityRRPicked(procPtr proc)
+{
+    if (proc->agedFrom != 0)
+    {
+        proc->priority = proc->agedFrom;
+        proc->agedFrom = 0;
+    }
+}
+
+/*
+ * Ages the ready list, then preempts proc if it has run longer than its
+ * quantum or aging raised a waiting process above it.
+ */
+static int priorityRRTick(procPtr proc, int currentTime)
+{
+    if (AGING_THRESHOLD > 0)
+    {
+        ageReadyList(currentTime);
+        int highest = highestReadyPriority(&ReadyList);
+        if (highest != -1 && highest < proc->priority)
+        {
+            return 1;
+        }
+    }
+    return currentTime - proc->startTime > getTimeSlice(proc);
+}
+
+/*
+ * Under strict priority, only a waiting process at proc's priority or higher
+ * can take the CPU from proc, unless aging may yet raise a lower one.
+ */
+static int priorityRRContended(procPtr proc)
+{
+    int highest = highestReadyPriority(&ReadyList);
+    if (AGING_THRESHOLD > 0)
+    {
+        return highest != -1 && (highest < SENTINELPRIORITY || proc->priority == SENTINELPRIORITY);
+    }
+    return highest != -1 && highest <= proc->priority;
+}
+
+/*
+ * A process at the running process's priority or higher runs first; at equal
+ * priority the running process goes to the back of the line, as it always has.
+ */
+static int priorityRRPreempts(procPtr proc, procPtr running)
+{
+    return proc->priority <= running->priority;
+}
+
+/*
+ * Raises by one priority every process that has waited AGING_THRESHOLD on the
+ * ready list since it was queued or last raised. Each level stays ordered by
+ * lastAged, so only the heads of the levels need to be looked at.
+ */
+static void ageReadyList(int currentTime)
+{
+    // Index i holds priority i + 1; the top level and the sentinel's are skipped
+    for (int level = 1; level < MINPRIORITY; level++)
+    {
+        procPtr proc = ReadyList.queues[level].head;
+        while (proc != NULL && currentTime - proc->lastAged > AGING_THRESHOLD)
+        {
+            unlinkProc(&ReadyList, proc);
+            if (proc->agedFrom == 0)
+            {
+                proc->agedFrom = proc->priority;
+            }
+            proc->priority--;
+            proc->lastAged = currentTime;
+            addProc(&ReadyList, proc);
+            KernelStats.agingBoosts++;
+            if (DEBUG && debugflag)
+            {
+                USLOSS_Console("ageReadyList(): Raising process %d to priority %d.\n", proc->pid, proc->priority);
+            }
+            proc = ReadyList.queues[level].head;
+        }
+    }
+}
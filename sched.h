@@ -0,0 +1,73 @@
+/*
+ * These are the definitions for sched.c, the scheduler policy interface that
+ * dispatcher() and the rest of the kernel use to manage runnable processes.
+ * The kernel calls the sched*() functions, which hand real-time processes to
+ * the EDF class (edf.c) and everything else to the policy Sched points to.
+ */
+
+#ifndef _SCHED_H
+#define _SCHED_H
+
+#include "kernel.h"
+
+typedef struct schedOps schedOps;
+
+struct schedOps
+{
+    char     *name;                          // policy name, for debugging output
+    void    (*init)(void);                   // called once from startup()
+    void    (*enqueue)(procPtr);             // make a ready process runnable (fork, preemption)
+    void    (*dequeue)(procPtr);             // remove a process from the run queue, wherever it is
+    procPtr (*pickNext)(void);               // remove and return the next process to run
+    int     (*tick)(procPtr, int);           // clock tick for the running proc at the given time; returns 1 to preempt it
+    void    (*wakeup)(procPtr);              // make a process that was blocked runnable again
+    void    (*charge)(procPtr, int);         // account microseconds of CPU just used by a process
+    int     (*contended)(procPtr);           // returns 1 if a clock tick could take the CPU from the running proc
+    int     (*preempts)(procPtr, procPtr);   // returns 1 if a newly runnable proc should run before the running one
+    void    (*picked)(procPtr);              // bookkeeping for a proc taken off the run queue to run (pickNext does this itself)
+};
+
+// Scheduler policies. Build with -DSCHED_POLICY=<policy> to select one.
+#define SCHED_PRIORITY_RR 0                  // strict priority, round robin within a priority
+#define SCHED_MLFQ 1                         // multilevel feedback queue
+#define SCHED_STRIDE 2                       // proportional share by tickets
+#define SCHED_CFS 3                          // weighted fair share by virtual runtime
+#define SCHED_SRTF 4                         // shortest predicted remaining burst first within a priority
+#define NUM_SCHED_POLICIES 5
+
+#ifndef SCHED_POLICY
+#define SCHED_POLICY SCHED_PRIORITY_RR
+#endif
+
+extern schedOps *Sched;
+extern int NeedResched;
+extern procPtr YieldTarget;
+extern schedOps PriorityRROps;
+extern schedOps MLFQOps;
+extern schedOps StrideOps;
+extern schedOps CFSOps;
+extern schedOps SRTFOps;
+extern schedOps RealTimeOps;
+
+#define IS_REAL_TIME(proc) ((proc)->rtPeriod > 0)
+
+void initScheduler(int);
+void noCharge(procPtr, int);
+void noPicked(procPtr);
+void schedEnqueue(procPtr);
+void schedDequeue(procPtr);
+void schedRequeue(procPtr);
+procPtr schedPickNext(void);
+int schedTick(procPtr, int);
+void schedWakeup(procPtr);
+void schedCharge(procPtr, int);
+void schedQuit(procPtr);
+int schedNeedsTick(procPtr);
+void reschedIfNeeded(int);
+
+// Real-time class
+void edfSetParams(procPtr, int, int, int);
+void edfRemove(procPtr);
+int edfThrottled(void);
+
+#endif
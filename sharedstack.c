@@ -0,0 +1,213 @@
+/* ------------------------------------------------------------------------
+   sharedstack.c
+   Defines the stack that lightweight processes share. A lightweight process
+   has no stack of its own: it runs on the shared stack, and when another
+   lightweight process needs the stack its live frames are copied out to a
+   buffer sized to fit them, then copied back before it runs again. Memory per
+   process is its actual stack depth rather than a reserved stack.
+
+   Frames only move when a different lightweight process takes the stack, so
+   switching between a lightweight process and normal ones costs nothing
+   extra. The copying is done by the switcher, a context with a stack of its
+   own, because nothing can safely overwrite the stack it is running on.
+
+   Under STACK_HIGH_WATER the switcher repaints the shared stack each time it
+   changes hands, so whatever is not paint belongs to the owner, and the
+   owner's high-water mark can be read off it like any other stack's.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#include "sharedstack.h"
+#include "stack.h"
+#include "phase1utility.h"
+#include <stdlib.h>
+#include <string.h>
+#include <usloss.h>
+
+/* ------------------------- Prototypes ----------------------------------- */
+static void switcher(void);
+static void saveFrames(procPtr);
+static void restoreFrames(procPtr);
+static void measureShared(procPtr);
+void launch();
+
+/* -------------------------- Globals ------------------------------------- */
+// The shared stack, and the lightweight proc whose frames are on it
+static char *SharedStack;
+static procPtr SharedOwner;
+
+// The switcher's context and stack, and the proc it is to switch to
+static USLOSS_Context SwitcherContext;
+static char *SwitcherStack;
+static procPtr SwitchTarget;
+
+extern kernelStats KernelStats;
+extern int StackPolicy;
+
+/* -------------------------- Functions ----------------------------------- */
+/*
+ * Creates the shared stack and the switcher, the first time a lightweight
+ * process is forked.
+ */
+void initSharedStack()
+{
+    if (SharedStack != NULL)
+    {
+        return;
+    }
+    SharedStack = allocStack(SHARED_STACK_SIZE, STACK_LAZY);
+    SwitcherStack = allocStack(USLOSS_MIN_STACK, StackPolicy);
+    if (SharedStack == NULL || SwitcherStack == NULL)
+    {
+        USLOSS_Console("forkLight(): Cannot allocate the shared stack.  Halting...\n");
+        USLOSS_Halt(1);
+    }
+    USLOSS_ContextInit(&SwitcherContext, SwitcherStack, USLOSS_MIN_STACK, NULL, switcher);
+}
+
+/*
+ * Returns the most bytes of the shared stack proc has used, measuring the
+ * stack again if proc owns it. Needs a build with STACK_HIGH_WATER.
+ */
+int sharedStackUse(procPtr proc)
+{
+    if (proc == SharedOwner)
+    {
+        measureShared(proc);
+    }
+    return proc->sharedStackDepth;
+}
+
+/*
+ * Notes how far down the shared stack the frames of proc, which is giving up
+ * the CPU, go. frame is an address in the dispatcher's frame.
+ */
+void leaveSharedStack(procPtr proc, char *frame)
+{
+    char *low = frame - SHARED_STACK_SLACK;
+    if (low < SharedStack)
+    {
+        low = SharedStack;
+    }
+    proc->sharedStackLow = low;
+    if (STACK_HIGH_WATER)
+    {
+        measureShared(proc);
+    }
+}
+
+/*
+ * Returns whether proc is lightweight and its frames are not on the shared
+ * stack, so switching to it must go through switchToShared().
+ */
+int needsSharedStack(procPtr proc)
+{
+    return proc->lightweight && proc != SharedOwner;
+}
+
+/*
+ * Saves the current context in old and switches to proc by way of the
+ * switcher, which puts proc's frames on the shared stack first. Interrupts
+ * must be disabled; proc runs with them enabled.
+ */
+void switchToShared(USLOSS_Context *old, procPtr proc)
+{
+    SwitchTarget = proc;
+    USLOSS_ContextSwitch(old, &SwitcherContext);
+}
+
+/*
+ * Frees the saved frames of proc, a lightweight proc that is dead.
+ */
+void releaseSharedStack(procPtr proc)
+{
+    if (SharedOwner == proc)
+    {
+        SharedOwner = NULL;
+    }
+    free(proc->savedStack);
+    proc->savedStack = NULL;
+    proc->savedStackCapacity = 0;
+}
+
+/*
+ * Body of the switcher context. Each pass hands the shared stack to
+ * SwitchTarget and switches to it; the next switchToShared() resumes here.
+ */
+static void switcher()
+{
+    while (1)
+    {
+        procPtr proc = SwitchTarget;
+        // A proc that has quit never runs again, so its frames can be lost
+        if (SharedOwner != NULL && SharedOwner->status != STATUS_QUIT)
+        {
+            saveFrames(SharedOwner);
+        }
+        if (STACK_HIGH_WATER)
+        {
+            clearStack(SharedStack, SHARED_STACK_SIZE);
+        }
+        if (proc->sharedStackLow == NULL)
+        {
+            // proc has not run yet, so start it at the top of the stack
+            USLOSS_ContextInit(&(proc->state), SharedStack, SHARED_STACK_SIZE, NULL, launch);
+        }
+        else
+        {
+            restoreFrames(proc);
+        }
+        SharedOwner = proc;
+        enableInterrupts();
+        USLOSS_ContextSwitch(&SwitcherContext, &(proc->state));
+    }
+}
+
+/*
+ * Copies the frames of proc off the shared stack, growing its buffer to fit.
+ */
+static void saveFrames(procPtr proc)
+{
+    int size = SharedStack + SHARED_STACK_SIZE - proc->sharedStackLow;
+    if (size > proc->savedStackCapacity)
+    {
+        char *buffer = realloc(proc->savedStack, size);
+        if (buffer == NULL)
+        {
+            USLOSS_Console("dispatcher(): Cannot save the stack of process %d.  Halting...\n", proc->pid);
+            USLOSS_Halt(1);
+        }
+        proc->savedStack = buffer;
+        proc->savedStackCapacity = size;
+    }
+    memcpy(proc->savedStack, proc->sharedStackLow, size);
+    KernelStats.stackCopies++;
+    KernelStats.stackBytesCopied += size;
+}
+
+/*
+ * Copies the frames of proc, saved by saveFrames(), back onto the shared
+ * stack.
+ */
+static void restoreFrames(procPtr proc)
+{
+    int size = SharedStack + SHARED_STACK_SIZE - proc->sharedStackLow;
+    memcpy(proc->sharedStackLow, proc->savedStack, size);
+    KernelStats.stackCopies++;
+    KernelStats.stackBytesCopied += size;
+}
+
+/*
+ * Raises the high-water mark of proc, which owns the shared stack, to the
+ * deepest word on the stack that is not paint.
+ */
+static void measureShared(procPtr proc)
+{
+    int depth = stackHighWater(SharedStack, SHARED_STACK_SIZE);
+    if (depth > proc->sharedStackDepth)
+    {
+        proc->sharedStackDepth = depth;
+    }
+}
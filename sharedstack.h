@@ -0,0 +1,31 @@
+/* ------------------------------------------------------------------------
+   sharedstack.h
+   Header for sharedstack.c. Include this file for access to the stack that
+   lightweight processes from forkLight() share.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#ifndef _SHAREDSTACK_H
+#define _SHAREDSTACK_H
+
+#include "kernel.h"
+
+// Size of the stack lightweight processes run on; none may go deeper than this
+#ifndef SHARED_STACK_SIZE
+#define SHARED_STACK_SIZE   (2 * USLOSS_MIN_STACK)
+#endif
+
+// Bytes below the dispatcher's frame that USLOSS_ContextSwitch() may use, and
+// so are copied out with the rest of a process's frames
+#define SHARED_STACK_SLACK  1024
+
+void initSharedStack(void);
+int sharedStackUse(procPtr);
+void leaveSharedStack(procPtr, char *);
+int needsSharedStack(procPtr);
+void switchToShared(USLOSS_Context *, procPtr);
+void releaseSharedStack(procPtr);
+
+#endif /* _SHAREDSTACK_H */
@@ -0,0 +1,147 @@
+/* ------------------------------------------------------------------------
+   srtf.c
+   Shortest remaining time first scheduler policy. The kernel predicts the
+   length of each process's next CPU burst (the CPU time it uses between
+   blocking) by exponential averaging of its past bursts. Priorities are
+   still strict, but within a priority the runnable process with the least
+   predicted time left in its burst runs first, and timeSlice() preempts the
+   running process as soon as a process at its priority is predicted to
+   finish sooner.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+
+   ------------------------------------------------------------------------ */
+
+#include "sched.h"
+#include "heap.h"
+#include "phase1utility.h"
+
+extern int debugflag;
+
+static void srtfInit(void);
+static void srtfEnqueue(procPtr);
+static void srtfDequeue(procPtr);
+static procPtr srtfPickNext(void);
+static int srtfTick(procPtr, int);
+static void srtfCharge(procPtr, int);
+static int srtfContended(procPtr);
+static int srtfPreempts(procPtr, procPtr);
+static long long sortKey(procPtr, int);
+
+// Runnable processes, ordered by priority, then predicted remaining burst
+static procHeap RunQueue;
+
+schedOps SRTFOps =
+{
+    "srtf",
+    srtfInit,
+    srtfEnqueue,
+    srtfDequeue,
+    srtfPickNext,
+    srtfTick,
+    srtfEnqueue,
+    srtfCharge,
+    srtfContended,
+    srtfPreempts,
+    noPicked,
+};
+
+static void srtfInit(void)
+{
+    initHeap(&RunQueue);
+}
+
+static void srtfEnqueue(procPtr proc)
+{
+    heapInsert(&RunQueue, proc, sortKey(proc, 0));
+}
+
+static void srtfDequeue(procPtr proc)
+{
+    heapRemove(&RunQueue, proc);
+}
+
+static procPtr srtfPickNext(void)
+{
+    return heapRemoveMin(&RunQueue);
+}
+
+/*
+ * Preempts proc if a runnable process has a higher priority, or the same
+ * priority and less predicted time left in its burst than proc has, counting
+ * the time proc has been running. Once proc's quantum is used up, it also
+ * gives way to processes at its priority with the same prediction, so they
+ * take turns.
+ */
+static int srtfTick(procPtr proc, int currentTime)
+{
+    procPtr next = heapPeekMin(&RunQueue);
+    if (next == NULL)
+    {
+        return 0;
+    }
+    int ran = currentTime - proc->startTime;
+    if (ran > getTimeSlice(proc) && next->priority <= proc->priority)
+    {
+        return 1;
+    }
+    return next->heapKey < sortKey(proc, ran);
+}
+
+/*
+ * Only a waiting process at proc's priority or higher can preempt proc.
+ */
+static int srtfContended(procPtr proc)
+{
+    procPtr next = heapPeekMin(&RunQueue);
+    return next != NULL && next->priority <= proc->priority;
+}
+
+/*
+ * A process with a higher priority, or the same priority and a shorter
+ * predicted remaining burst, runs first.
+ */
+static int srtfPreempts(procPtr proc, procPtr running)
+{
+    return sortKey(proc, 0) < sortKey(running, 0);
+}
+
+/*
+ * Adds the CPU time proc just used to its current burst. If proc is not
+ * ready any more, the burst is over, so it is folded into the estimate of the
+ * next one.
+ */
+static void srtfCharge(procPtr proc, int deltaTime)
+{
+    proc->burstTime += deltaTime;
+    if (proc->status == STATUS_READY)
+    {
+        return;
+    }
+    proc->burstEstimate = (BURST_WEIGHT * proc->burstTime + (100 - BURST_WEIGHT) * proc->burstEstimate) / 100;
+    proc->burstTime = 0;
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("srtfCharge(): Process %d now has burst estimate %d.\n", proc->pid, proc->burstEstimate);
+    }
+}
+
+/*
+ * Returns the heap key of proc after it has run for ran more microseconds:
+ * its priority in the high bits and its predicted remaining burst in the low
+ * bits. A process that has run past its estimate is predicted to run as long
+ * again as it has so far, so a long burst that was guessed short falls behind
+ * genuinely short ones instead of jumping ahead of them.
+ */
+static long long sortKey(procPtr proc, int ran)
+{
+    long long used = (long long) proc->burstTime + ran;
+    long long remaining = proc->burstEstimate - used;
+    if (remaining < 0)
+    {
+        remaining = used;
+    }
+    return proc->priority * (1LL << 32) + remaining;
+}
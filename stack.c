@@ -0,0 +1,320 @@
+/* ------------------------------------------------------------------------
+   stack.c
+   Defines the pool that process stacks come from. Stack sizes are rounded up
+   to a size class, and the stack of a dead process goes onto its class's free
+   list, so the next fork1() of that class reuses it without a system call.
+   A free stack holds the free list link in its first bytes.
+
+   Each stack is its own anonymous mapping with an inaccessible guard page
+   below it, so a process that overflows its stack faults instead of
+   corrupting its neighbours. Pages are committed as they are touched, or all
+   up front under STACK_PREFAULT.
+
+   Under STACK_HIGH_WATER, stacks are painted with STACK_PAINT when they are
+   mapped, so the deepest word that no longer holds the paint marks how far
+   the stack has grown. A non-zero paint keeps zeros a process wrote, such as
+   a zeroed local array, from looking unused. Painting commits every page of
+   the stack. A stack going back to the pool has only its used part painted
+   again.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#include "stack.h"
+#include "kernel.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <usloss.h>
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* ------------------------- Prototypes ----------------------------------- */
+static int sizeClass(int);
+static char *mapStack(int, int);
+static void unmapStack(char *, int);
+static void prefault(char *, int);
+static int pageSize(void);
+static unsigned int hashName(char *);
+
+/* -------------------------- Globals ------------------------------------- */
+typedef struct freeStack freeStackNode;
+
+struct freeStack
+{
+    freeStackNode *next;
+};
+
+static freeStackNode *FreeStacks[STACK_CLASSES];
+static int NumFreeStacks[STACK_CLASSES];
+
+// How fork1() commits new stacks; set by setStackPolicy()
+int StackPolicy = STACK_POLICY;
+
+// Stack use of the processes that have quit, by name
+typedef struct stackUse stackUse;
+
+struct stackUse
+{
+    char name[MAXNAME];     // Empty if this entry is unused
+    int  count;             // Processes by this name that have quit
+    int  maxUsed;           // Deepest any of them went (bytes)
+    long totalUsed;
+    int  maxSize;           // Largest stack any of them had (bytes)
+};
+
+static stackUse StackUse[STACK_REPORT_NAMES];
+static stackUse OtherStackUse = { "(other)" };
+
+extern kernelStats KernelStats;
+
+/* -------------------------- Functions ----------------------------------- */
+/*
+ * Returns the number of bytes allocStack() gives a stack that must hold at
+ * least size bytes: its class's size, or size rounded up to whole pages.
+ */
+int stackAllocSize(int size)
+{
+    int class = sizeClass(size);
+    if (class != -1)
+    {
+        return USLOSS_MIN_STACK << class;
+    }
+    return (size + pageSize() - 1) / pageSize() * pageSize();
+}
+
+/*
+ * Returns a stack of stackAllocSize(size) bytes committed according to policy,
+ * or NULL if memory ran out.
+ */
+char *allocStack(int size, int policy)
+{
+    int class = sizeClass(size);
+    size = stackAllocSize(size);
+    if (class == -1 || FreeStacks[class] == NULL)
+    {
+        return mapStack(size, policy);
+    }
+    freeStackNode *stack = FreeStacks[class];
+    FreeStacks[class] = stack->next;
+    NumFreeStacks[class]--;
+    KernelStats.stacksReused++;
+    // Paint over the free list link so the stack is all paint again
+    memset(stack, STACK_PAINT, sizeof(freeStackNode));
+    if (policy == STACK_PREFAULT)
+    {
+        prefault((char *) stack, size);
+    }
+    return (char *) stack;
+}
+
+/*
+ * Returns a stack from allocStack(size) to the pool. The stack must no longer
+ * be in use.
+ */
+void freeStack(char *stack, int size)
+{
+    int class = sizeClass(size);
+    if (class == -1 || NumFreeStacks[class] >= STACK_POOL_MAX)
+    {
+        unmapStack(stack, size);
+        return;
+    }
+    // The next process to get this stack must find it painted
+    if (STACK_HIGH_WATER)
+    {
+        clearStack(stack, size);
+    }
+    freeStackNode *node = (freeStackNode *) stack;
+    node->next = FreeStacks[class];
+    FreeStacks[class] = node;
+    NumFreeStacks[class]++;
+}
+
+/*
+ * Returns the number of bytes at the top of stack, which has size bytes, that
+ * have been written to. Stacks grow down, so this is the distance from the
+ * top to the deepest word that no longer holds the paint.
+ */
+int stackHighWater(char *stack, int size)
+{
+    long paint;
+    memset(&paint, STACK_PAINT, sizeof(paint));
+    long *word = (long *) stack;
+    long *top = (long *) (stack + size);
+    while (word < top && *word == paint)
+    {
+        word++;
+    }
+    return (char *) top - (char *) word;
+}
+
+/*
+ * Paints over the part of stack, which has size bytes, that has been used.
+ */
+void clearStack(char *stack, int size)
+{
+    int used = stackHighWater(stack, size);
+    memset(stack + size - used, STACK_PAINT, used);
+}
+
+/*
+ * Adds a process that quit, having used used bytes of its size byte stack, to
+ * the totals for its name.
+ */
+void recordStackUse(char *name, int used, int size)
+{
+    stackUse *entry = &OtherStackUse;
+    unsigned int start = hashName(name) % STACK_REPORT_NAMES;
+    for (int i = 0; i < STACK_REPORT_NAMES; i++)
+    {
+        stackUse *candidate = &StackUse[(start + i) % STACK_REPORT_NAMES];
+        if (candidate->name[0] == '\0')
+        {
+            strcpy(candidate->name, name);
+            entry = candidate;
+            break;
+        }
+        if (strcmp(candidate->name, name) == 0)
+        {
+            entry = candidate;
+            break;
+        }
+    }
+    entry->count++;
+    entry->totalUsed += used;
+    if (used > entry->maxUsed)
+    {
+        entry->maxUsed = used;
+    }
+    if (size > entry->maxSize)
+    {
+        entry->maxSize = size;
+    }
+}
+
+/*
+ * Prints the stack use of the processes that have quit, by name.
+ */
+void printStackReport(void)
+{
+    USLOSS_Console("Name\t\tCount\tMax\tMean\tStack\tMax used\n");
+    for (int i = 0; i <= STACK_REPORT_NAMES; i++)
+    {
+        stackUse *entry = i < STACK_REPORT_NAMES ? &StackUse[i] : &OtherStackUse;
+        if (entry->count == 0)
+        {
+            continue;
+        }
+        USLOSS_Console("%-15s\t%d\t%d\t%ld\t%d\t%d%%\n", entry->name, entry->count, entry->maxUsed,
+                       entry->totalUsed / entry->count, entry->maxSize, 100 * entry->maxUsed / entry->maxSize);
+    }
+}
+
+/*
+ * Returns the smallest class whose stacks hold size bytes, or -1 if size is
+ * too large for any class.
+ */
+static int sizeClass(int size)
+{
+    for (int class = 0; class < STACK_CLASSES; class++)
+    {
+        if (size <= USLOSS_MIN_STACK << class)
+        {
+            return class;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Maps a stack of size bytes, a multiple of the page size, with a guard page
+ * below it. Returns the lowest usable address, or NULL if the map failed.
+ */
+static char *mapStack(int size, int policy)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+    if (policy == STACK_PREFAULT)
+    {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    char *base = mmap(NULL, size + pageSize(), PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    // Stacks grow down, so the guard goes at the low end
+    if (mprotect(base, pageSize(), PROT_NONE) != 0)
+    {
+        munmap(base, size + pageSize());
+        return NULL;
+    }
+#ifdef MAP_POPULATE
+    // MAP_POPULATE committed the guard page too; give it back
+    if (policy == STACK_PREFAULT)
+    {
+        madvise(base, pageSize(), MADV_DONTNEED);
+    }
+#else
+    if (policy == STACK_PREFAULT)
+    {
+        prefault(base + pageSize(), size);
+    }
+#endif
+    if (STACK_HIGH_WATER)
+    {
+        memset(base + pageSize(), STACK_PAINT, size);
+    }
+    return base + pageSize();
+}
+
+/*
+ * Unmaps a stack from mapStack(), guard page included.
+ */
+static void unmapStack(char *stack, int size)
+{
+    munmap(stack - pageSize(), size + pageSize());
+}
+
+/*
+ * Touches every page of a stack so that it is resident before it is used.
+ */
+static void prefault(char *stack, int size)
+{
+    for (int offset = 0; offset < size; offset += pageSize())
+    {
+        ((volatile char *) stack)[offset] = 0;
+    }
+}
+
+/*
+ * Returns the size of a virtual memory page.
+ */
+static int pageSize(void)
+{
+    static int size = 0;
+    if (size == 0)
+    {
+        size = sysconf(_SC_PAGESIZE);
+    }
+    return size;
+}
+
+/*
+ * Hashes a process name for the stack use table.
+ */
+static unsigned int hashName(char *name)
+{
+    unsigned int hash = 5381;
+    for (char *c = name; *c != '\0'; c++)
+    {
+        hash = hash * 33 + (unsigned char) *c;
+    }
+    return hash;
+}
@@ -0,0 +1,48 @@
+/* ------------------------------------------------------------------------
+   stack.h
+   Header for stack.c. Include this file for access to the pool that process
+   stacks are allocated from.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#ifndef _STACK_H
+#define _STACK_H
+
+// Stack sizes are rounded up to USLOSS_MIN_STACK << k for a class k below
+// STACK_CLASSES. Larger stacks bypass the pool.
+#define STACK_CLASSES   4
+
+// Most free stacks the pool keeps in each class; the rest are freed
+#ifndef STACK_POOL_MAX
+#define STACK_POOL_MAX  64
+#endif
+
+// Commit policy for stacks until setStackPolicy() changes it
+#ifndef STACK_POLICY
+#define STACK_POLICY    STACK_LAZY
+#endif
+
+// Measure how much of its stack each process uses, for dumpProcesses() and
+// dumpStackUsage(). Build with -DSTACK_HIGH_WATER=1.
+#ifndef STACK_HIGH_WATER
+#define STACK_HIGH_WATER 0
+#endif
+
+// Byte that unused stack is painted with for STACK_HIGH_WATER. It is not zero,
+// so zeros a process writes to its stack still count as used.
+#define STACK_PAINT      0xA5
+
+// Most process names dumpStackUsage() reports separately
+#define STACK_REPORT_NAMES 64
+
+int stackAllocSize(int);
+char *allocStack(int, int);
+void freeStack(char *, int);
+int stackHighWater(char *, int);
+void clearStack(char *, int);
+void recordStackUse(char *, int, int);
+void printStackReport(void);
+
+#endif /* _STACK_H */
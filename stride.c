@@ -0,0 +1,155 @@
+/* ------------------------------------------------------------------------
+   stride.c
+   Stride scheduler policy. Every process holds some number of tickets
+   (DEFAULT_TICKETS of its priority at fork1() time, or whatever setTickets()
+   gave it) and is charged STRIDE1 / tickets pass for each microsecond of CPU
+   it uses. The runnable process with the smallest pass runs next, so over
+   time each process receives CPU in proportion to its tickets.
+
+   Processes at SENTINELPRIORITY hold no tickets; they stay on the ReadyList
+   and only run when no ticket holder is runnable.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+
+   ------------------------------------------------------------------------ */
+
+#include "sched.h"
+#include "queue.h"
+#include "heap.h"
+#include "phase1utility.h"
+
+extern priorityQueue ReadyList;
+extern int debugflag;
+
+static void strideInit(void);
+static void strideEnqueue(procPtr);
+static void strideDequeue(procPtr);
+static procPtr stridePickNext(void);
+static int strideTick(procPtr, int);
+static void strideCharge(procPtr, int);
+static int strideContended(procPtr);
+static int stridePreempts(procPtr, procPtr);
+static void stridePicked(procPtr);
+
+// Runnable ticket holders, ordered by pass
+static procHeap StrideHeap;
+
+// The pass of the most recently dispatched ticket holder
+static long globalPass = 0;
+
+schedOps StrideOps =
+{
+    "stride",
+    strideInit,
+    strideEnqueue,
+    strideDequeue,
+    stridePickNext,
+    strideTick,
+    strideEnqueue,
+    strideCharge,
+    strideContended,
+    stridePreempts,
+    stridePicked,
+};
+
+static void strideInit(void)
+{
+    initPriorityQueue(&ReadyList);
+    initHeap(&StrideHeap);
+    globalPass = 0;
+}
+
+/*
+ * Makes proc runnable. A process that is new or has been blocked may not
+ * come back with a pass behind everyone else's, or it would monopolize the
+ * CPU until it caught up.
+ */
+static void strideEnqueue(procPtr proc)
+{
+    if (proc->priority == SENTINELPRIORITY)
+    {
+        addProc(&ReadyList, proc);
+        return;
+    }
+    if (proc->pass < globalPass)
+    {
+        proc->pass = globalPass;
+    }
+    heapInsert(&StrideHeap, proc, proc->pass);
+}
+
+static void strideDequeue(procPtr proc)
+{
+    heapRemove(&StrideHeap, proc);
+    unlinkProc(&ReadyList, proc);
+}
+
+static procPtr stridePickNext(void)
+{
+    procPtr next = heapRemoveMin(&StrideHeap);
+    if (next == NULL)
+    {
+        return removeProc(&ReadyList);
+    }
+    stridePicked(next);
+    return next;
+}
+
+/*
+ * Remembers the pass of the ticket holder about to run, as the pass that new
+ * and woken processes start from.
+ */
+static void stridePicked(procPtr proc)
+{
+    if (proc->priority != SENTINELPRIORITY)
+    {
+        globalPass = proc->pass;
+    }
+}
+
+/*
+ * Preempts proc once it has run longer than its quantum.
+ */
+static int strideTick(procPtr proc, int currentTime)
+{
+    return currentTime - proc->startTime > getTimeSlice(proc);
+}
+
+/*
+ * Advances the pass of proc by its stride for each microsecond it just ran.
+ */
+static void strideCharge(procPtr proc, int deltaTime)
+{
+    if (proc->priority == SENTINELPRIORITY)
+    {
+        return;
+    }
+    proc->pass += (long) (STRIDE1 / proc->tickets) * deltaTime;
+    if (DEBUG && debugflag)
+    {
+        USLOSS_Console("strideCharge(): Process %d now has pass %ld.\n", proc->pid, proc->pass);
+    }
+}
+
+/*
+ * Any waiting ticket holder competes with the running process.
+ */
+static int strideContended(procPtr proc)
+{
+    return StrideHeap.size > 0;
+}
+
+/*
+ * A ticket holder whose pass is behind the running process's runs first. The
+ * sentinel gives way to anyone.
+ */
+static int stridePreempts(procPtr proc, procPtr running)
+{
+    if (running->priority == SENTINELPRIORITY)
+    {
+        return 1;
+    }
+    return proc->priority != SENTINELPRIORITY && proc->pass < running->pass;
+}
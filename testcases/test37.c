@@ -0,0 +1,80 @@
+/* Tests that a real-time process whose budget is close to its period gets
+ * its whole budget every period, even while it is still running when the
+ * next period is released.
+ *
+ * start1 creates Hog at priority 4, which spins until RealTime is done
+ * start1 creates RealTime at priority 3 and gives it a 100 ms period, a
+ * 90 ms budget and a 100 ms deadline
+ * start1 blocks on joins
+ *
+ * RealTime spins for 2 seconds of wall time. It should get about 90% of
+ * the CPU, and Hog the rest.
+ */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define PERIOD   100000
+#define BUDGET    90000
+#define RUN_TIME 2000000
+
+int Hog(char *);
+int RealTime(char *);
+
+int done = 0;
+
+void test_setup(int argc, char *argv[])
+{
+}
+
+void test_cleanup(int argc, char *argv[])
+{
+}
+
+static int now(void)
+{
+    int time;
+    USLOSS_DeviceInput(USLOSS_CLOCK_DEV, 0, &time);
+    return time;
+}
+
+int start1(char *arg)
+{
+    int status, hogPid, rtPid;
+
+    USLOSS_Console("start1(): started\n");
+    hogPid = fork1("Hog", Hog, NULL, USLOSS_MIN_STACK, 4);
+    rtPid = fork1("RealTime", RealTime, NULL, USLOSS_MIN_STACK, 3);
+    USLOSS_Console("start1(): setDeadline returned %d\n",
+                   setDeadline(rtPid, PERIOD, BUDGET, PERIOD));
+
+    join(&status);
+    join(&status);
+    USLOSS_Console("start1(): joined children %d and %d\n", hogPid, rtPid);
+    quit(0);
+    return 0; /* so gcc will not complain about its absence... */
+}
+
+int Hog(char *arg)
+{
+    while (!done)
+    {
+    }
+    quit(0);
+    return 0;
+}
+
+int RealTime(char *arg)
+{
+    int start = now();
+    while (now() - start < RUN_TIME)
+    {
+    }
+    // 90% of the time would be 1800 ms; losing every other period gives ~1000
+    int cpu = readtime();
+    USLOSS_Console("RealTime(): got at least 1500 ms of CPU: %s\n", cpu >= 1500 ? "yes" : "no");
+    done = 1;
+    quit(0);
+    return 0;
+}
@@ -0,0 +1,222 @@
+/* ------------------------------------------------------------------------
+   timer.c
+   Defines the kernel callouts, kept on a hierarchical timing wheel. The
+   lowest wheel has a slot for each of the next WHEEL_SIZE clock ticks; each
+   wheel above it covers WHEEL_SIZE times the span of the one below. A callout
+   goes into the lowest wheel whose span reaches its expiry, and is moved down
+   a wheel each time the wheel below wraps around. Adding and cancelling a
+   callout take constant time, and the clock interrupt only touches the slots
+   of the ticks that have passed.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#include "timer.h"
+#include "kernel.h"
+#include "phase1utility.h"
+#include <stdlib.h>
+
+/* ------------------------- Prototypes ----------------------------------- */
+static void place(calloutPtr);
+static void removeFromSlot(calloutPtr);
+static int cascade(int);
+
+/* -------------------------- Globals ------------------------------------- */
+static calloutPtr Wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+// The next tick to run. Every callout expiring before it has run.
+static int WheelTick;
+
+// The number of callouts on the wheel
+static int NumPending;
+
+extern kernelStats KernelStats;
+
+/* -------------------------- Functions ----------------------------------- */
+/*
+ * Empties the timing wheel and starts it at currentTime (microseconds).
+ */
+void initCallouts(int currentTime)
+{
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+    {
+        for (int i = 0; i < WHEEL_SIZE; i++)
+        {
+            Wheel[level][i] = NULL;
+        }
+    }
+    WheelTick = currentTime / TIMER_TICK;
+    NumPending = 0;
+}
+
+/*
+ * Arranges for func(arg) to be called from the clock interrupt once the time
+ * reaches when (microseconds). A time in the past runs at the next clock
+ * interrupt. c must not already be pending.
+ */
+void addCallout(calloutPtr c, int when, void (*func)(void *), void *arg)
+{
+    // Round up, so a callout never runs early
+    c->expires = (when + TIMER_TICK - 1) / TIMER_TICK;
+    c->func = func;
+    c->arg = arg;
+    // The clock interrupt leaves an empty wheel alone, so bring it up to date
+    if (NumPending == 0)
+    {
+        WheelTick = readKernelTime() / TIMER_TICK;
+    }
+    place(c);
+    NumPending++;
+}
+
+/*
+ * Stops c from running. Returns 1 if c was pending, 0 if it had already run
+ * or was never added.
+ */
+int cancelCallout(calloutPtr c)
+{
+    if (c->slot == NULL)
+    {
+        return 0;
+    }
+    removeFromSlot(c);
+    NumPending--;
+    return 1;
+}
+
+/*
+ * Returns 1 iff c is waiting to run.
+ */
+int calloutPending(calloutPtr c)
+{
+    return c->slot != NULL;
+}
+
+/*
+ * Returns the number of callouts waiting to run.
+ */
+int calloutsPending(void)
+{
+    return NumPending;
+}
+
+/*
+ * Runs every callout that expires at or before currentTime (microseconds).
+ * Called from the clock interrupt. A callout may add or cancel callouts.
+ */
+void runCallouts(int currentTime)
+{
+    int now = currentTime / TIMER_TICK;
+    if (NumPending == 0)
+    {
+        // Nothing to move or run, so skip the ticks that have passed
+        if (now >= WheelTick)
+        {
+            WheelTick = now + 1;
+        }
+        return;
+    }
+    while (now - WheelTick >= 0)
+    {
+        int index = WheelTick & WHEEL_MASK;
+        // When a wheel wraps around, bring the next slot of the wheel above down
+        for (int level = 1; level < WHEEL_LEVELS && index == 0; level++)
+        {
+            index = cascade(level);
+        }
+        index = WheelTick & WHEEL_MASK;
+        WheelTick++;
+
+        calloutPtr c;
+        while ((c = Wheel[0][index]) != NULL)
+        {
+            removeFromSlot(c);
+            NumPending--;
+            KernelStats.calloutsRun++;
+            c->func(c->arg);
+        }
+        if (NumPending == 0)
+        {
+            WheelTick = now + 1;
+        }
+    }
+}
+
+/*
+ * Puts c in the slot of the lowest wheel whose span reaches its expiry.
+ */
+static void place(calloutPtr c)
+{
+    int delta = c->expires - WheelTick;
+    int expires = c->expires;
+    int level = 0;
+    if (delta < 0)
+    {
+        // Already due; run it at the next tick
+        expires = WheelTick;
+    }
+    else
+    {
+        while (level < WHEEL_LEVELS - 1 && delta >= (1 << (WHEEL_BITS * (level + 1))))
+        {
+            level++;
+        }
+        if (delta >= (1 << (WHEEL_BITS * WHEEL_LEVELS)))
+        {
+            // Beyond the top wheel; park it as far out as possible and let it
+            // be placed again when it comes around
+            expires = WheelTick + (1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+        }
+    }
+    calloutPtr *slot = &Wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    c->slot = slot;
+    c->prev = NULL;
+    c->next = *slot;
+    if (*slot != NULL)
+    {
+        (*slot)->prev = c;
+    }
+    *slot = c;
+}
+
+/*
+ * Takes c out of its wheel slot.
+ */
+static void removeFromSlot(calloutPtr c)
+{
+    if (c->prev != NULL)
+    {
+        c->prev->next = c->next;
+    }
+    else
+    {
+        *(c->slot) = c->next;
+    }
+    if (c->next != NULL)
+    {
+        c->next->prev = c->prev;
+    }
+    c->next = NULL;
+    c->prev = NULL;
+    c->slot = NULL;
+}
+
+/*
+ * Moves every callout in the current slot of wheel level down to the wheels
+ * below it. Returns the index of that slot, so the caller knows whether this
+ * wheel has wrapped around too.
+ */
+static int cascade(int level)
+{
+    int index = (WheelTick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    calloutPtr c = Wheel[level][index];
+    Wheel[level][index] = NULL;
+    while (c != NULL)
+    {
+        calloutPtr next = c->next;
+        place(c);
+        c = next;
+    }
+    return index;
+}
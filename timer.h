@@ -0,0 +1,45 @@
+/* ------------------------------------------------------------------------
+   timer.h
+   Header for timer.c. Contains the typedef for a kernel callout, a function
+   that the clock interrupt runs at a given time. Include this file for access
+   to the callout functions.
+
+   University of Arizona
+   Computer Science 452
+   Fall 2017
+   ------------------------------------------------------------------------ */
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include <usloss.h>
+
+// Callouts are kept to the resolution of the clock interrupt (microseconds)
+#define TIMER_TICK      (USLOSS_CLOCK_MS * 1000)
+
+// Shape of the timing wheel: WHEEL_LEVELS wheels of WHEEL_SIZE slots each
+#define WHEEL_BITS      6
+#define WHEEL_SIZE      (1 << WHEEL_BITS)
+#define WHEEL_MASK      (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS    4
+
+typedef struct callout callout;
+typedef struct callout * calloutPtr;
+
+struct callout
+{
+    calloutPtr  next;                   // Links within a wheel slot
+    calloutPtr  prev;
+    calloutPtr *slot;                   // The wheel slot holding this callout, or NULL if not pending
+    int         expires;                // The tick at which this callout runs
+    void      (*func)(void *);
+    void       *arg;
+};
+
+void initCallouts(int);
+void addCallout(calloutPtr, int, void (*)(void *), void *);
+int cancelCallout(calloutPtr);
+int calloutPending(calloutPtr);
+int calloutsPending(void);
+void runCallouts(int);
+
+#endif /* _TIMER_H */